@@ -1,8 +1,8 @@
 #include <dirent.h>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <unistd.h>
-#include <asm-generic/fcntl.h>
 #include <fcntl.h>
 #include <cstring>
 #include "include/hprof_dump.h"
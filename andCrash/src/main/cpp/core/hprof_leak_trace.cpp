@@ -0,0 +1,676 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unordered_set>
+#include "include/hprof_leak_trace.h"
+#include "include/log_utils.h"
+
+// HPROF记录tag
+static constexpr uint8_t TAG_STRING = 0x01;
+static constexpr uint8_t TAG_LOAD_CLASS = 0x02;
+static constexpr uint8_t TAG_HEAP_DUMP = 0x0c;
+static constexpr uint8_t TAG_HEAP_DUMP_SEGMENT = 0x1c;
+
+// HEAP_DUMP子记录tag
+static constexpr uint8_t ROOT_UNKNOWN = 0xff;
+static constexpr uint8_t ROOT_JNI_GLOBAL = 0x01;
+static constexpr uint8_t ROOT_JNI_LOCAL = 0x02;
+static constexpr uint8_t ROOT_JAVA_FRAME = 0x03;
+static constexpr uint8_t ROOT_NATIVE_STACK = 0x04;
+static constexpr uint8_t ROOT_STICKY_CLASS = 0x05;
+static constexpr uint8_t ROOT_THREAD_BLOCK = 0x06;
+static constexpr uint8_t ROOT_MONITOR_USED = 0x07;
+static constexpr uint8_t ROOT_THREAD_OBJECT = 0x08;
+static constexpr uint8_t ROOT_INTERNED_STRING = 0x89;
+static constexpr uint8_t ROOT_FINALIZING = 0x8a;
+static constexpr uint8_t ROOT_DEBUGGER = 0x8b;
+static constexpr uint8_t ROOT_REFERENCE_CLEANUP = 0x8c;
+static constexpr uint8_t ROOT_VM_INTERNAL = 0x8d;
+static constexpr uint8_t ROOT_JNI_MONITOR = 0x8e;
+static constexpr uint8_t ROOT_UNREACHABLE = 0x90;
+static constexpr uint8_t HEAP_DUMP_INFO = 0xfe;
+static constexpr uint8_t PRIMITIVE_ARRAY_NODATA = 0xc3;
+static constexpr uint8_t CLASS_DUMP = 0x20;
+static constexpr uint8_t INSTANCE_DUMP = 0x21;
+static constexpr uint8_t OBJECT_ARRAY_DUMP = 0x22;
+static constexpr uint8_t PRIMITIVE_ARRAY_DUMP = 0x23;
+
+// 字段类型
+static constexpr uint8_t TYPE_OBJECT = 2;
+
+static inline uint16_t readU2(const uint8_t *p) {
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t readU4(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static std::string dotted(std::string name) {
+    std::replace(name.begin(), name.end(), '/', '.');
+    return name;
+}
+
+static const char *rootTypeName(uint8_t type) {
+    switch (type) {
+        case ROOT_JNI_GLOBAL:
+            return "JNI_GLOBAL";
+        case ROOT_JNI_LOCAL:
+            return "JNI_LOCAL";
+        case ROOT_JAVA_FRAME:
+            return "JAVA_FRAME";
+        case ROOT_NATIVE_STACK:
+            return "NATIVE_STACK";
+        case ROOT_STICKY_CLASS:
+            return "STICKY_CLASS";
+        case ROOT_THREAD_BLOCK:
+            return "THREAD_BLOCK";
+        case ROOT_MONITOR_USED:
+            return "MONITOR_USED";
+        case ROOT_THREAD_OBJECT:
+            return "THREAD_OBJECT";
+        case ROOT_INTERNED_STRING:
+            return "INTERNED_STRING";
+        case ROOT_FINALIZING:
+            return "FINALIZING";
+        case ROOT_DEBUGGER:
+            return "DEBUGGER";
+        case ROOT_REFERENCE_CLEANUP:
+            return "REFERENCE_CLEANUP";
+        case ROOT_VM_INTERNAL:
+            return "VM_INTERNAL";
+        case ROOT_JNI_MONITOR:
+            return "JNI_MONITOR";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+HprofLeakTrace::~HprofLeakTrace() {
+    close();
+}
+
+bool HprofLeakTrace::open(const char *filename) {
+    close();
+    int fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_utils::error("AndCrash", "open hprof failed: %s", filename);
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        log_utils::error("AndCrash", "mmap hprof failed: %s", filename);
+        return false;
+    }
+    m_data = static_cast<const uint8_t *>(data);
+    m_size = (size_t) st.st_size;
+
+    // 建索引时顺序扫描，BFS阶段随机访问
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    bool ok = indexRecords();
+    madvise(data, m_size, MADV_RANDOM);
+    if (!ok) {
+        log_utils::error("AndCrash", "malformed hprof: %s", filename);
+        close();
+        return false;
+    }
+
+    // 按id排序得到稠密下标
+    std::sort(m_objects.begin(), m_objects.end(), [](const ObjectEntry &a, const ObjectEntry &b) {
+        return a.id < b.id;
+    });
+    for (auto &it: m_classNames) {
+        if (dotted(stringOf(it.second)) == "java.lang.ref.Reference") {
+            m_referenceClassId = it.first;
+            break;
+        }
+    }
+    return true;
+}
+
+void HprofLeakTrace::close() {
+    if (m_data) {
+        munmap(const_cast<uint8_t *>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_objects.clear();
+    m_objects.shrink_to_fit();
+    m_roots.clear();
+    m_classes.clear();
+    m_classNames.clear();
+    m_strings.clear();
+    m_referenceClassId = 0;
+}
+
+uint64_t HprofLeakTrace::readId(const uint8_t *p) const {
+    if (m_idSize == 4) {
+        return readU4(p);
+    }
+    return ((uint64_t) readU4(p) << 32) | readU4(p + 4);
+}
+
+size_t HprofLeakTrace::typeSize(uint8_t type) const {
+    switch (type) {
+        case TYPE_OBJECT:
+            return m_idSize;
+        case 4:  // boolean
+        case 8:  // byte
+            return 1;
+        case 5:  // char
+        case 9:  // short
+            return 2;
+        case 6:  // float
+        case 10: // int
+            return 4;
+        case 7:  // double
+        case 11: // long
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+bool HprofLeakTrace::indexRecords() {
+    // 头部：版本字符串\0 + u4 id长度 + u8 时间戳
+    const auto *end = static_cast<const uint8_t *>(memchr(m_data, 0, m_size));
+    if (!end) {
+        return false;
+    }
+    uint64_t pos = (uint64_t) (end - m_data) + 1;
+    if (pos + 12 > m_size) {
+        return false;
+    }
+    m_idSize = readU4(m_data + pos);
+    if (m_idSize != 4 && m_idSize != 8) {
+        return false;
+    }
+    pos += 12;
+
+    while (pos + 9 <= m_size) {
+        uint8_t tag = m_data[pos];
+        uint32_t length = readU4(m_data + pos + 5);
+        uint64_t body = pos + 9;
+        if (body + length > m_size) {
+            return false;
+        }
+        const uint8_t *p = m_data + body;
+        switch (tag) {
+            case TAG_STRING:
+                m_strings[readId(p)] = pos;
+                break;
+            case TAG_LOAD_CLASS:
+                m_classNames[readId(p + 4)] = readId(p + 8 + m_idSize);
+                break;
+            case TAG_HEAP_DUMP:
+            case TAG_HEAP_DUMP_SEGMENT:
+                if (!indexHeapDump(body, body + length)) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+        pos = body + length;
+    }
+    return true;
+}
+
+bool HprofLeakTrace::indexHeapDump(uint64_t begin, uint64_t end) {
+    const uint32_t id = m_idSize;
+    const uint8_t *limit = m_data + end;
+    uint64_t pos = begin;
+    while (pos < end) {
+        const uint8_t *p = m_data + pos;
+        // 读取子记录头部字段前先确认没有越过记录末尾（截断/损坏的最后一个segment）
+        auto fits = [p, limit](const uint8_t *from, uint64_t size) {
+            return from >= p && from <= limit && size <= (uint64_t) (limit - from);
+        };
+        uint8_t tag = p[0];
+        uint64_t len;
+        switch (tag) {
+            case ROOT_UNKNOWN:
+            case ROOT_STICKY_CLASS:
+            case ROOT_MONITOR_USED:
+            case ROOT_INTERNED_STRING:
+            case ROOT_FINALIZING:
+            case ROOT_DEBUGGER:
+            case ROOT_REFERENCE_CLEANUP:
+            case ROOT_VM_INTERNAL:
+                len = id;
+                break;
+            case ROOT_JNI_GLOBAL:
+                len = id * 2;
+                break;
+            case ROOT_JNI_LOCAL:
+            case ROOT_JAVA_FRAME:
+            case ROOT_THREAD_OBJECT:
+            case ROOT_JNI_MONITOR:
+                len = id + 8;
+                break;
+            case ROOT_NATIVE_STACK:
+            case ROOT_THREAD_BLOCK:
+                len = id + 4;
+                break;
+            case ROOT_UNREACHABLE:
+                // 不可达对象不是真正的GC Root
+                len = id;
+                break;
+            case HEAP_DUMP_INFO:
+                len = 4 + id;
+                break;
+            case PRIMITIVE_ARRAY_NODATA:
+                len = id + 9;
+                break;
+            case CLASS_DUMP: {
+                // class id + u4 + 6个id（父类、loader、signers、protection domain、2个保留）+ u4实例大小 + u2
+                const uint8_t *q = p + 1 + id + 4 + id * 6;
+                if (!fits(p + 1, id + 4 + id * 6 + 4 + 2)) {
+                    return false;
+                }
+                uint64_t classId = readId(p + 1);
+                uint64_t superId = readId(p + 1 + id + 4);
+                uint32_t instanceSize = readU4(q);
+                q += 4;
+                uint16_t cpCount = readU2(q);
+                q += 2;
+                for (uint16_t i = 0; i < cpCount; ++i) {
+                    size_t size = fits(q, 3) ? typeSize(q[2]) : 0;
+                    if (size == 0 || !fits(q, 3 + size)) {
+                        return false;
+                    }
+                    q += 3 + size;
+                }
+                if (!fits(q, 2)) {
+                    return false;
+                }
+                uint16_t staticCount = readU2(q);
+                q += 2;
+                for (uint16_t i = 0; i < staticCount; ++i) {
+                    size_t size = fits(q, id + 1) ? typeSize(q[id]) : 0;
+                    if (size == 0 || !fits(q, id + 1 + size)) {
+                        return false;
+                    }
+                    q += id + 1 + size;
+                }
+                if (!fits(q, 2)) {
+                    return false;
+                }
+                uint16_t fieldCount = readU2(q);
+                q += 2;
+                if (!fits(q, (uint64_t) fieldCount * (id + 1))) {
+                    return false;
+                }
+                q += (uint64_t) fieldCount * (id + 1);
+                ClassInfo &info = m_classes[classId];
+                info.superId = superId;
+                info.offset = pos;
+                info.instanceSize = instanceSize;
+                m_objects.push_back({classId, pos});
+                len = (uint64_t) (q - p) - 1;
+                break;
+            }
+            case INSTANCE_DUMP:
+                if (!fits(p + 1, id + 4 + id + 4)) {
+                    return false;
+                }
+                len = id + 4 + id + 4 + readU4(p + 1 + id + 4 + id);
+                break;
+            case OBJECT_ARRAY_DUMP:
+                if (!fits(p + 1, id + 4 + 4)) {
+                    return false;
+                }
+                len = id + 4 + 4 + id + (uint64_t) readU4(p + 1 + id + 4) * id;
+                break;
+            case PRIMITIVE_ARRAY_DUMP: {
+                if (!fits(p + 1, id + 9)) {
+                    return false;
+                }
+                size_t size = typeSize(p[1 + id + 8]);
+                if (size == 0) {
+                    return false;
+                }
+                len = id + 9 + (uint64_t) readU4(p + 1 + id + 4) * size;
+                break;
+            }
+            default:
+                log_utils::error("AndCrash", "unknown heap dump sub tag: 0x%x", tag);
+                return false;
+        }
+        if (!fits(p + 1, len)) {
+            return false;
+        }
+        switch (tag) {
+            case ROOT_UNREACHABLE:
+            case HEAP_DUMP_INFO:
+            case PRIMITIVE_ARRAY_NODATA:
+            case CLASS_DUMP:
+                break;
+            case INSTANCE_DUMP:
+            case OBJECT_ARRAY_DUMP:
+            case PRIMITIVE_ARRAY_DUMP:
+                m_objects.push_back({readId(p + 1), pos});
+                break;
+            default:
+                m_roots.push_back({readId(p + 1), tag});
+                break;
+        }
+        pos += 1 + len;
+    }
+    return true;
+}
+
+std::string HprofLeakTrace::stringOf(uint64_t id) const {
+    auto it = m_strings.find(id);
+    if (it == m_strings.end()) {
+        return {};
+    }
+    const uint8_t *p = m_data + it->second;
+    uint32_t length = readU4(p + 5);
+    if (length < m_idSize) {
+        return {};
+    }
+    return {reinterpret_cast<const char *>(p + 9 + m_idSize), length - m_idSize};
+}
+
+HprofLeakTrace::ClassInfo *HprofLeakTrace::findClass(uint64_t classId) {
+    auto it = m_classes.find(classId);
+    if (it == m_classes.end()) {
+        return nullptr;
+    }
+    resolveClass(classId, it->second);
+    return &it->second;
+}
+
+void HprofLeakTrace::resolveClass(uint64_t classId, ClassInfo &info) {
+    if (info.resolved) {
+        return;
+    }
+    info.resolved = true;
+    const uint32_t id = m_idSize;
+    const uint8_t *q = m_data + info.offset + 1 + id + 4 + id * 6 + 4;
+    uint16_t cpCount = readU2(q);
+    q += 2;
+    for (uint16_t i = 0; i < cpCount; ++i) {
+        q += 3 + typeSize(q[2]);
+    }
+    uint16_t staticCount = readU2(q);
+    q += 2;
+    for (uint16_t i = 0; i < staticCount; ++i) {
+        uint64_t nameId = readId(q);
+        uint8_t type = q[id];
+        if (type == TYPE_OBJECT) {
+            uint64_t value = readId(q + id + 1);
+            if (value != 0) {
+                info.staticRefs.emplace_back(nameId, value);
+            }
+        }
+        q += id + 1 + typeSize(type);
+    }
+
+    // 实例数据布局：先本类字段，再依次是父类字段
+    info.isReference = classId == m_referenceClassId;
+    uint16_t fieldCount = readU2(q);
+    q += 2;
+    uint32_t offset = 0;
+    for (uint16_t i = 0; i < fieldCount; ++i) {
+        uint64_t nameId = readId(q);
+        uint8_t type = q[id];
+        if (type == TYPE_OBJECT) {
+            // Reference.referent是弱/软/虚引用，不算强引用链
+            if (!(info.isReference && stringOf(nameId) == "referent")) {
+                info.refFields.push_back({offset, nameId});
+            }
+        }
+        offset += (uint32_t) typeSize(type);
+        q += id + 1;
+    }
+
+    if (info.superId != 0) {
+        ClassInfo *super = findClass(info.superId);
+        if (super) {
+            info.isReference = info.isReference || super->isReference;
+            for (const FieldRef &f: super->refFields) {
+                info.refFields.push_back({f.offset + offset, f.nameId});
+            }
+        }
+    }
+}
+
+uint32_t HprofLeakTrace::indexOf(uint64_t id) const {
+    auto it = std::lower_bound(m_objects.begin(), m_objects.end(), id,
+                               [](const ObjectEntry &e, uint64_t v) { return e.id < v; });
+    if (it == m_objects.end() || it->id != id) {
+        return kNoIndex;
+    }
+    return (uint32_t) (it - m_objects.begin());
+}
+
+template<typename Visitor>
+void HprofLeakTrace::forEachReference(uint32_t index, Visitor &&visitor) {
+    const uint32_t id = m_idSize;
+    const uint8_t *p = m_data + m_objects[index].offset;
+    switch (p[0]) {
+        case INSTANCE_DUMP: {
+            ClassInfo *info = findClass(readId(p + 1 + id + 4));
+            if (!info) {
+                return;
+            }
+            uint32_t length = readU4(p + 1 + id + 4 + id);
+            const uint8_t *values = p + 1 + id + 4 + id + 4;
+            for (const FieldRef &f: info->refFields) {
+                if (f.offset + id > length) {
+                    continue;
+                }
+                uint64_t child = readId(values + f.offset);
+                if (child != 0 && !visitor(child, f.nameId, 0)) {
+                    return;
+                }
+            }
+            break;
+        }
+        case OBJECT_ARRAY_DUMP: {
+            uint32_t count = readU4(p + 1 + id + 4);
+            const uint8_t *elements = p + 1 + id + 4 + 4 + id;
+            for (uint32_t i = 0; i < count; ++i) {
+                uint64_t child = readId(elements + (uint64_t) i * id);
+                if (child != 0 && !visitor(child, 0, i)) {
+                    return;
+                }
+            }
+            break;
+        }
+        case CLASS_DUMP: {
+            ClassInfo *info = findClass(m_objects[index].id);
+            if (!info) {
+                return;
+            }
+            for (const auto &f: info->staticRefs) {
+                if (!visitor(f.second, f.first, 0)) {
+                    return;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+std::vector<LeakTrace> HprofLeakTrace::findPaths(const std::vector<uint64_t> &objectIds) {
+    std::vector<LeakTrace> result;
+    const size_t count = m_objects.size();
+    if (!m_data || count == 0 || objectIds.empty()) {
+        return result;
+    }
+
+    // 稠密下标bitset：visited / target
+    const size_t words = (count + 63) / 64;
+    std::vector<uint64_t> visited(words, 0);
+    std::vector<uint64_t> targets(words, 0);
+    size_t remaining = 0;
+    for (uint64_t objectId: objectIds) {
+        uint32_t index = indexOf(objectId);
+        if (index != kNoIndex && !(targets[index >> 6] & (1ULL << (index & 63)))) {
+            targets[index >> 6] |= 1ULL << (index & 63);
+            remaining++;
+        }
+    }
+    if (remaining == 0) {
+        return result;
+    }
+
+    std::vector<uint32_t> parent(count, kNoIndex);
+    std::unordered_map<uint32_t, uint8_t> rootTypes;
+    std::vector<uint32_t> queue;
+    std::vector<uint32_t> found;
+
+    auto discover = [&](uint32_t index, uint32_t from) {
+        uint64_t bit = 1ULL << (index & 63);
+        if (visited[index >> 6] & bit) {
+            return;
+        }
+        visited[index >> 6] |= bit;
+        parent[index] = from;
+        queue.push_back(index);
+        if (targets[index >> 6] & bit) {
+            found.push_back(index);
+            remaining--;
+        }
+    };
+
+    for (const Root &root: m_roots) {
+        uint32_t index = indexOf(root.id);
+        if (index != kNoIndex && rootTypes.emplace(index, root.type).second) {
+            discover(index, kNoIndex);
+        }
+    }
+
+    // BFS：先到达即最短
+    for (size_t head = 0; head < queue.size() && remaining > 0; ++head) {
+        uint32_t current = queue[head];
+        forEachReference(current, [&](uint64_t child, uint64_t, uint32_t) {
+            uint32_t index = indexOf(child);
+            if (index != kNoIndex) {
+                discover(index, current);
+            }
+            return remaining > 0;
+        });
+    }
+
+    for (uint32_t target: found) {
+        std::vector<uint32_t> chain;
+        for (uint32_t i = target; i != kNoIndex; i = parent[i]) {
+            chain.push_back(i);
+        }
+        std::reverse(chain.begin(), chain.end());
+
+        LeakTrace trace;
+        trace.targetId = m_objects[target].id;
+        trace.rootType = rootTypes[chain.front()];
+        for (size_t i = 0; i < chain.size(); ++i) {
+            LeakTraceElement element;
+            element.objectId = m_objects[chain[i]].id;
+            element.className = className(chain[i]);
+            if (i + 1 < chain.size()) {
+                element.referenceName = referenceName(chain[i], m_objects[chain[i + 1]].id);
+            }
+            trace.elements.push_back(std::move(element));
+        }
+        result.push_back(std::move(trace));
+    }
+    return result;
+}
+
+std::vector<LeakTrace> HprofLeakTrace::findPathsByClass(const std::string &name) {
+    const std::string target = dotted(name);
+    std::unordered_set<uint64_t> classIds;
+    for (auto &it: m_classNames) {
+        if (dotted(stringOf(it.second)) == target) {
+            classIds.insert(it.first);
+        }
+    }
+    std::vector<uint64_t> objectIds;
+    if (classIds.empty()) {
+        return {};
+    }
+    const uint32_t id = m_idSize;
+    for (const ObjectEntry &e: m_objects) {
+        const uint8_t *p = m_data + e.offset;
+        if (p[0] == INSTANCE_DUMP && classIds.count(readId(p + 1 + id + 4))) {
+            objectIds.push_back(e.id);
+        }
+    }
+    return findPaths(objectIds);
+}
+
+std::string HprofLeakTrace::referenceName(uint32_t parent, uint64_t childId) {
+    std::string name;
+    forEachReference(parent, [&](uint64_t child, uint64_t nameId, uint32_t arrayIndex) {
+        if (child != childId) {
+            return true;
+        }
+        if (nameId != 0) {
+            name = stringOf(nameId);
+        } else {
+            name = "[" + std::to_string(arrayIndex) + "]";
+        }
+        return false;
+    });
+    return name;
+}
+
+std::string HprofLeakTrace::className(uint32_t index) {
+    const uint32_t id = m_idSize;
+    const uint8_t *p = m_data + m_objects[index].offset;
+    auto nameOf = [this](uint64_t classId) {
+        auto it = m_classNames.find(classId);
+        return it == m_classNames.end() ? std::string("??") : dotted(stringOf(it->second));
+    };
+    switch (p[0]) {
+        case INSTANCE_DUMP:
+            return nameOf(readId(p + 1 + id + 4));
+        case OBJECT_ARRAY_DUMP:
+            return nameOf(readId(p + 1 + id + 8));
+        case CLASS_DUMP:
+            return "class " + nameOf(m_objects[index].id);
+        case PRIMITIVE_ARRAY_DUMP: {
+            static const char *names[] = {"", "", "", "", "boolean[]", "char[]", "float[]",
+                                          "double[]", "byte[]", "short[]", "int[]", "long[]"};
+            uint8_t type = p[1 + id + 8];
+            return type < 12 ? names[type] : "??";
+        }
+        default:
+            return "??";
+    }
+}
+
+std::string HprofLeakTrace::format(const LeakTrace &trace) {
+    std::string out;
+    char line[64];
+    snprintf(line, sizeof(line), "GC Root: %s\n", rootTypeName(trace.rootType));
+    out += line;
+    for (size_t i = 0; i < trace.elements.size(); ++i) {
+        const LeakTraceElement &e = trace.elements[i];
+        snprintf(line, sizeof(line), "#%02zu 0x%" PRIx64 " ", i, e.objectId);
+        out += line;
+        out += e.className;
+        if (!e.referenceName.empty()) {
+            out += e.referenceName[0] == '[' ? " " : " .";
+            out += e.referenceName;
+        }
+        out += "\n";
+    }
+    return out;
+}
@@ -0,0 +1,123 @@
+#ifndef ANDROIDPERFORMANCEMONITORING_HPROF_LEAK_TRACE_H
+#define ANDROIDPERFORMANCEMONITORING_HPROF_LEAK_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 引用链上的一个节点：对象 + 指向下一个节点的引用名（字段名 / [index]）
+struct LeakTraceElement {
+    uint64_t objectId;
+    std::string className;
+    std::string referenceName;
+};
+
+// 单个目标对象到GC Root的最短引用链，elements[0]为GC Root
+struct LeakTrace {
+    uint64_t targetId;
+    uint8_t rootType;
+    std::vector<LeakTraceElement> elements;
+};
+
+/**
+ * 基于mmap的HPROF最短引用链查询
+ *
+ * open()只扫描一次文件建立对象索引（对象id -> 稠密下标），之后每次查询
+ * 从全部GC Root出发做一次BFS，visited使用bitset，弱/软引用的referent不参与遍历，
+ * 一次遍历可同时回答多个目标对象
+ */
+class HprofLeakTrace final {
+public:
+    HprofLeakTrace() = default;
+
+    ~HprofLeakTrace();
+
+    HprofLeakTrace(const HprofLeakTrace &) = delete;
+
+    void operator=(const HprofLeakTrace &) = delete;
+
+    // 打开并索引hprof文件
+    bool open(const char *filename);
+
+    void close();
+
+    // 按对象id查询，找不到引用链的目标不会出现在结果中
+    std::vector<LeakTrace> findPaths(const std::vector<uint64_t> &objectIds);
+
+    // 查询某个类（例如泄漏的Activity）的所有实例
+    std::vector<LeakTrace> findPathsByClass(const std::string &className);
+
+    // 将引用链格式化为可读文本
+    static std::string format(const LeakTrace &trace);
+
+private:
+    static constexpr uint32_t kNoIndex = UINT32_MAX;
+
+    struct ObjectEntry {
+        uint64_t id;
+        uint64_t offset;   // 子记录在文件中的偏移（指向sub tag）
+    };
+
+    struct FieldRef {
+        uint32_t offset;   // 在实例数据中的偏移
+        uint64_t nameId;
+    };
+
+    struct ClassInfo {
+        uint64_t superId = 0;
+        uint32_t instanceSize = 0;
+        uint64_t offset = 0;
+        bool resolved = false;
+        bool isReference = false;
+        // 展开后的引用字段（含父类），弱/软引用的referent已剔除
+        std::vector<FieldRef> refFields;
+        // 静态引用字段：<字段名string id, 引用对象id>
+        std::vector<std::pair<uint64_t, uint64_t>> staticRefs;
+    };
+
+    struct Root {
+        uint64_t id;
+        uint8_t type;
+    };
+
+    bool indexRecords();
+
+    bool indexHeapDump(uint64_t begin, uint64_t end);
+
+    void resolveClass(uint64_t classId, ClassInfo &info);
+
+    ClassInfo *findClass(uint64_t classId);
+
+    uint32_t indexOf(uint64_t id) const;
+
+    // 遍历对象的所有出边，visitor返回false时提前结束
+    template<typename Visitor>
+    void forEachReference(uint32_t index, Visitor &&visitor);
+
+    std::string referenceName(uint32_t parent, uint64_t childId);
+
+    std::string className(uint32_t index);
+
+    std::string stringOf(uint64_t id) const;
+
+    uint64_t readId(const uint8_t *p) const;
+
+    size_t typeSize(uint8_t type) const;
+
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    uint32_t m_idSize = 4;
+
+    std::vector<ObjectEntry> m_objects;
+    std::vector<Root> m_roots;
+    std::unordered_map<uint64_t, ClassInfo> m_classes;
+    std::unordered_map<uint64_t, uint64_t> m_classNames;   // class id -> name string id
+    std::unordered_map<uint64_t, uint64_t> m_strings;      // string id -> 记录偏移
+    uint64_t m_referenceClassId = 0;
+};
+
+
+#endif //ANDROIDPERFORMANCEMONITORING_HPROF_LEAK_TRACE_H
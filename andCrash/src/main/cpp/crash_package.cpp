@@ -0,0 +1,400 @@
+#include "crash_package.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "core/include/log_utils.h"
+
+static const char kHeaderMagic[4] = {'A', 'C', 'P', 'K'};
+static const char kChunkMagic[4] = {'A', 'C', 'H', 'K'};
+static const char kTrailerMagic[4] = {'A', 'C', 'P', 'E'};
+static const uint16_t kVersion = 1;
+static const size_t kHeaderSize = 16;
+static const size_t kChunkHeaderSize = 24;
+static const size_t kTrailerSize = 24;
+static const uint32_t kMaxIndexSize = 16 * 1024 * 1024;
+
+// 已经压缩过的格式，再压缩没有收益，走零拷贝
+static const char *const kCompressedSuffixes[] = {".gz", ".zip", ".zst", ".xz", ".bz2", ".png", ".jpg", ".webp"};
+
+static void PutU16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+}
+
+static void PutU32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (uint8_t) (v >> (8 * i));
+}
+
+static void PutU64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = (uint8_t) (v >> (8 * i));
+}
+
+static uint16_t GetU16(const uint8_t *p) {
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t GetU32(const uint8_t *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t GetU64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+static bool WriteFully(int fd, const void *data, size_t size) {
+    auto *p = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t) n;
+    }
+    return true;
+}
+
+static size_t ReadFully(int fd, void *data, size_t size) {
+    auto *p = static_cast<uint8_t *>(data);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = read(fd, p + total, size - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        total += (size_t) n;
+    }
+    return total;
+}
+
+static bool PreadFully(int fd, void *data, size_t size, uint64_t offset) {
+    auto *p = static_cast<uint8_t *>(data);
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, (off_t) offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t) n;
+        offset += (uint64_t) n;
+    }
+    return true;
+}
+
+/**
+ * src[offset, offset+size) 追加到dst当前位置：copy_file_range（同文件系统内核内拷贝）
+ * -> sendfile -> 从映射write
+ */
+static bool CopyRange(int srcFd, const uint8_t *mapped, uint64_t offset, size_t size, int dstFd) {
+#if defined(__NR_copy_file_range)
+    static bool copyFileRangeUnsupported = false;
+    while (size > 0 && !copyFileRangeUnsupported) {
+        loff_t in = (loff_t) offset;
+        ssize_t n = syscall(__NR_copy_file_range, srcFd, &in, dstFd, nullptr, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            // ENOSYS（内核<4.5）、EXDEV（跨文件系统，5.3之前）等，之后统一降级
+            copyFileRangeUnsupported = n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL);
+            break;
+        }
+        offset += (uint64_t) n;
+        size -= (size_t) n;
+    }
+#endif
+    while (size > 0) {
+        off_t in = (off_t) offset;
+        ssize_t n = sendfile(dstFd, srcFd, &in, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        offset += (uint64_t) n;
+        size -= (size_t) n;
+    }
+    return size == 0 || WriteFully(dstFd, mapped + offset, size);
+}
+
+static bool IsCompressed(const std::string &name) {
+    for (const char *suffix: kCompressedSuffixes) {
+        size_t len = strlen(suffix);
+        if (name.size() > len && name.compare(name.size() - len, len, suffix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool WriteChunkHeader(int fd, uint32_t entryIndex, uint8_t method, uint32_t rawSize,
+                             uint32_t storedSize, uint32_t crc) {
+    uint8_t header[kChunkHeaderSize] = {};
+    memcpy(header, kChunkMagic, 4);
+    PutU32(header + 4, entryIndex);
+    header[8] = method;
+    PutU32(header + 12, rawSize);
+    PutU32(header + 16, storedSize);
+    PutU32(header + 20, crc);
+    return WriteFully(fd, header, sizeof(header));
+}
+
+int64_t CrashPackage::Pack(const std::string &archivePath, const std::vector<std::string> &files,
+                           uint32_t chunkSize, std::vector<std::string> *skipped) {
+    if (chunkSize == 0 || chunkSize > kMaxChunkSize) {
+        chunkSize = kDefaultChunkSize;
+    }
+    std::string tmpPath = archivePath + ".tmp";
+    int out = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (out == -1) {
+        log_utils::error("AndCrash", "CrashPackage open %s failed: %s", tmpPath.c_str(), strerror(errno));
+        return -1;
+    }
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        close(out);
+        unlink(tmpPath.c_str());
+        return -1;
+    }
+    std::vector<uint8_t> raw(chunkSize);
+    std::vector<uint8_t> packed(deflateBound(&zs, chunkSize));
+
+    uint8_t header[kHeaderSize] = {};
+    memcpy(header, kHeaderMagic, 4);
+    PutU16(header + 4, kVersion);
+    PutU32(header + 8, chunkSize);
+    bool ok = WriteFully(out, header, sizeof(header));
+    uint64_t pos = kHeaderSize;
+
+    std::vector<Entry> entries;
+    for (size_t f = 0; ok && f < files.size(); ++f) {
+        int in = open(files[f].c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st{};
+        if (in == -1 || fstat(in, &st) != 0 || !S_ISREG(st.st_mode)) {
+            log_utils::warn("AndCrash", "CrashPackage skip %s", files[f].c_str());
+            if (in != -1) close(in);
+            if (skipped) skipped->push_back(files[f]);
+            continue;
+        }
+        size_t slash = files[f].find_last_of('/');
+        Entry entry{slash == std::string::npos ? files[f] : files[f].substr(slash + 1),
+                    0, (uint32_t) crc32(0, Z_NULL, 0), (int64_t) st.st_mtime, pos, 0};
+        auto index = (uint32_t) entries.size();
+
+        if (IsCompressed(entry.name) && st.st_size > 0) {
+            // 原样存储：crc从映射上算，数据在内核内拷贝，不经过用户态缓冲
+            auto size = (uint64_t) st.st_size;
+            void *map = mmap(nullptr, (size_t) size, PROT_READ, MAP_PRIVATE, in, 0);
+            if (map == MAP_FAILED) {
+                log_utils::warn("AndCrash", "CrashPackage skip %s: mmap failed: %s", files[f].c_str(), strerror(errno));
+                close(in);
+                if (skipped) skipped->push_back(files[f]);
+                continue;
+            }
+            madvise(map, (size_t) size, MADV_SEQUENTIAL);
+            auto *mapped = static_cast<const uint8_t *>(map);
+            for (uint64_t off = 0; ok && off < size; off += chunkSize) {
+                auto n = (uint32_t) std::min<uint64_t>(chunkSize, size - off);
+                auto crc = (uint32_t) crc32(0, mapped + off, n);
+                entry.crc = (uint32_t) crc32_combine(entry.crc, crc, n);
+                ok = WriteChunkHeader(out, index, Stored, n, n, crc) && CopyRange(in, mapped, off, n, out);
+                pos += kChunkHeaderSize + n;
+                entry.chunks++;
+            }
+            entry.size = size;
+            munmap(map, (size_t) size);
+        } else {
+            // 读到EOF为止（日志可能还在追加），以实际读到的大小为准
+            size_t n;
+            while (ok && (n = ReadFully(in, raw.data(), chunkSize)) > 0) {
+                auto crc = (uint32_t) crc32(0, raw.data(), (uInt) n);
+                entry.crc = (uint32_t) crc32_combine(entry.crc, crc, (z_off_t) n);
+                deflateReset(&zs);
+                zs.next_in = raw.data();
+                zs.avail_in = (uInt) n;
+                zs.next_out = packed.data();
+                zs.avail_out = (uInt) packed.size();
+                if (deflate(&zs, Z_FINISH) == Z_STREAM_END && zs.total_out < n) {
+                    ok = WriteChunkHeader(out, index, Deflate, (uint32_t) n, (uint32_t) zs.total_out, crc)
+                         && WriteFully(out, packed.data(), zs.total_out);
+                    pos += kChunkHeaderSize + zs.total_out;
+                } else {
+                    ok = WriteChunkHeader(out, index, Stored, (uint32_t) n, (uint32_t) n, crc)
+                         && WriteFully(out, raw.data(), n);
+                    pos += kChunkHeaderSize + n;
+                }
+                entry.size += n;
+                entry.chunks++;
+                if (n < chunkSize) break;
+            }
+        }
+        close(in);
+        entries.push_back(std::move(entry));
+    }
+    deflateEnd(&zs);
+
+    // 索引：u16 名字长度 | 名字 | u64 大小 | u32 crc | i64 mtime | u64 偏移 | u32 块数
+    std::vector<uint8_t> index;
+    for (const Entry &e: entries) {
+        size_t at = index.size();
+        auto nameLen = (uint16_t) std::min<size_t>(e.name.size(), UINT16_MAX);
+        index.resize(at + 2 + nameLen + 32);
+        uint8_t *p = index.data() + at;
+        PutU16(p, nameLen);
+        memcpy(p + 2, e.name.data(), nameLen);
+        p += 2 + nameLen;
+        PutU64(p, e.size);
+        PutU32(p + 8, e.crc);
+        PutU64(p + 12, (uint64_t) e.mtime);
+        PutU64(p + 20, e.offset);
+        PutU32(p + 28, e.chunks);
+    }
+    uint8_t trailer[kTrailerSize];
+    PutU64(trailer, pos);
+    PutU32(trailer + 8, (uint32_t) index.size());
+    PutU32(trailer + 12, (uint32_t) crc32(0, index.data(), (uInt) index.size()));
+    PutU32(trailer + 16, (uint32_t) entries.size());
+    memcpy(trailer + 20, kTrailerMagic, 4);
+    ok = ok && WriteFully(out, index.data(), index.size()) && WriteFully(out, trailer, sizeof(trailer));
+    ok = ok && fdatasync(out) == 0;
+    if (close(out) != 0 || !ok || rename(tmpPath.c_str(), archivePath.c_str()) != 0) {
+        log_utils::error("AndCrash", "CrashPackage write %s failed: %s", archivePath.c_str(), strerror(errno));
+        unlink(tmpPath.c_str());
+        return -1;
+    }
+    return (int64_t) (pos + index.size() + kTrailerSize);
+}
+
+// 读头部和索引，返回块大小，失败返回0
+static uint32_t ReadArchive(int fd, std::vector<CrashPackage::Entry> &entries) {
+    struct stat st{};
+    uint8_t header[kHeaderSize];
+    uint8_t trailer[kTrailerSize];
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < kHeaderSize + kTrailerSize
+        || !PreadFully(fd, header, sizeof(header), 0)
+        || !PreadFully(fd, trailer, sizeof(trailer), (uint64_t) st.st_size - kTrailerSize)
+        || memcmp(header, kHeaderMagic, 4) != 0 || GetU16(header + 4) != kVersion
+        || memcmp(trailer + 20, kTrailerMagic, 4) != 0) {
+        return 0;
+    }
+    uint32_t chunkSize = GetU32(header + 8);
+    uint64_t indexOffset = GetU64(trailer);
+    uint32_t indexSize = GetU32(trailer + 8);
+    uint32_t count = GetU32(trailer + 16);
+    if (chunkSize == 0 || chunkSize > CrashPackage::kMaxChunkSize || indexSize > kMaxIndexSize
+        || indexOffset + indexSize + kTrailerSize != (uint64_t) st.st_size) {
+        return 0;
+    }
+    std::vector<uint8_t> index(indexSize);
+    if (!PreadFully(fd, index.data(), indexSize, indexOffset)
+        || (uint32_t) crc32(0, index.data(), (uInt) indexSize) != GetU32(trailer + 12)) {
+        return 0;
+    }
+    entries.clear();
+    size_t at = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (at + 2 > indexSize) return 0;
+        uint16_t nameLen = GetU16(index.data() + at);
+        if (at + 2 + nameLen + 32 > indexSize) return 0;
+        const uint8_t *p = index.data() + at + 2;
+        CrashPackage::Entry e;
+        e.name.assign(reinterpret_cast<const char *>(p), nameLen);
+        p += nameLen;
+        e.size = GetU64(p);
+        e.crc = GetU32(p + 8);
+        e.mtime = (int64_t) GetU64(p + 12);
+        e.offset = GetU64(p + 20);
+        e.chunks = GetU32(p + 28);
+        entries.push_back(std::move(e));
+        at += 2 + nameLen + 32;
+    }
+    return chunkSize;
+}
+
+bool CrashPackage::ReadIndex(const std::string &archivePath, std::vector<Entry> &entries) {
+    int fd = open(archivePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    uint32_t chunkSize = ReadArchive(fd, entries);
+    close(fd);
+    return chunkSize != 0;
+}
+
+bool CrashPackage::Extract(const std::string &archivePath, const std::string &outDir) {
+    int fd = open(archivePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    std::vector<Entry> entries;
+    uint32_t chunkSize = ReadArchive(fd, entries);
+    z_stream zs{};
+    if (chunkSize == 0 || inflateInit2(&zs, -15) != Z_OK) {
+        close(fd);
+        return false;
+    }
+    std::vector<uint8_t> raw(chunkSize);
+    std::vector<uint8_t> packed(compressBound(chunkSize) + 64);
+
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < entries.size(); ++i) {
+        const Entry &e = entries[i];
+        int out = -1;
+        if (!outDir.empty()) {
+            if (e.name.empty() || e.name == "." || e.name == ".." || e.name.find('/') != std::string::npos) {
+                ok = false;
+                break;
+            }
+            std::string path = outDir + "/" + e.name;
+            out = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+            if (out == -1) {
+                ok = false;
+                break;
+            }
+        }
+        uint64_t pos = e.offset;
+        uint64_t total = 0;
+        auto crc = (uint32_t) crc32(0, Z_NULL, 0);
+        for (uint32_t c = 0; ok && c < e.chunks; ++c) {
+            uint8_t header[kChunkHeaderSize];
+            ok = PreadFully(fd, header, sizeof(header), pos);
+            uint32_t rawSize = GetU32(header + 12);
+            uint32_t storedSize = GetU32(header + 16);
+            ok = ok && memcmp(header, kChunkMagic, 4) == 0 && GetU32(header + 4) == i
+                 && rawSize <= chunkSize && storedSize <= packed.size();
+            ok = ok && PreadFully(fd, packed.data(), storedSize, pos + kChunkHeaderSize);
+            if (!ok) break;
+            if (header[8] == Deflate) {
+                inflateReset(&zs);
+                zs.next_in = packed.data();
+                zs.avail_in = storedSize;
+                zs.next_out = raw.data();
+                zs.avail_out = rawSize;
+                ok = inflate(&zs, Z_FINISH) == Z_STREAM_END && zs.total_out == rawSize;
+            } else if (header[8] == Stored) {
+                ok = storedSize == rawSize;
+                if (ok) memcpy(raw.data(), packed.data(), rawSize);
+            } else {
+                ok = false;
+            }
+            ok = ok && (uint32_t) crc32(0, raw.data(), rawSize) == GetU32(header + 20);
+            ok = ok && (out == -1 || WriteFully(out, raw.data(), rawSize));
+            crc = (uint32_t) crc32_combine(crc, GetU32(header + 20), rawSize);
+            total += rawSize;
+            pos += kChunkHeaderSize + storedSize;
+        }
+        ok = ok && total == e.size && crc == e.crc;
+        if (out != -1) {
+            close(out);
+        }
+        if (!ok) {
+            log_utils::error("AndCrash", "CrashPackage entry %s corrupted", e.name.c_str());
+        }
+    }
+    inflateEnd(&zs);
+    close(fd);
+    return ok;
+}
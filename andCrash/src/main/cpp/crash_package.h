@@ -0,0 +1,59 @@
+#ifndef ANDROID_CRASH_PACKAGE_H
+#define ANDROID_CRASH_PACKAGE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * 崩溃日志批量打包
+ *
+ * 把多个崩溃日志/面包屑/hprof片段流式写入一个分块归档，一次上传：
+ *   [Header][Chunk]...[Chunk][Index][Trailer]
+ * 每个Chunk只属于一个条目，独立压缩（raw deflate）并带原始数据crc32，
+ * 上传中断后可以从任意Chunk偏移续传，服务端也能逐块校验。
+ * 已压缩的文件（.gz/.zip等）或压缩无收益的块原样存储，整条目原样存储时用copy_file_range/sendfile在内核内拷贝。
+ * 内存占用与文件大小无关：一个输入块 + 一个输出块 + zlib状态。
+ * 所有多字节字段为小端序。
+ */
+class CrashPackage final {
+public:
+    static constexpr uint32_t kDefaultChunkSize = 256 * 1024;
+    static constexpr uint32_t kMaxChunkSize = 4 * 1024 * 1024;
+
+    enum Method : uint8_t {
+        Stored = 0,
+        Deflate = 1,
+    };
+
+    struct Entry {
+        std::string name;
+        uint64_t size;          // 原始大小
+        uint32_t crc;           // 原始数据crc32
+        int64_t mtime;
+        uint64_t offset;        // 第一个Chunk在归档中的偏移（续传点）
+        uint32_t chunks;
+    };
+
+    /**
+     * 打包files到archivePath（先写.tmp再rename），条目名为文件名
+     * @param skipped 非空时返回无法读取而被跳过的输入文件，调用方不能把它们当作已打包删除
+     * @return 归档大小，失败返回-1
+     */
+    static int64_t Pack(const std::string &archivePath, const std::vector<std::string> &files,
+                        uint32_t chunkSize = kDefaultChunkSize, std::vector<std::string> *skipped = nullptr);
+
+    // 读取并校验索引
+    static bool ReadIndex(const std::string &archivePath, std::vector<Entry> &entries);
+
+    /**
+     * 逐块校验crc；outDir非空时把条目还原到该目录
+     */
+    static bool Extract(const std::string &archivePath, const std::string &outDir);
+
+    CrashPackage(const CrashPackage &) = delete;
+
+    void operator=(const CrashPackage &) = delete;
+};
+
+#endif //ANDROID_CRASH_PACKAGE_H
@@ -0,0 +1,405 @@
+#include "crash_storage.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/stat.h>
+#include "core/include/log_utils.h"
+
+static const char *kManifestName = ".manifest";
+static const char *kManifestTmpName = ".manifest.tmp";
+
+// 崩溃报告的文件名：crash-*.log（见CrashHandler::GenerateCrashLogPath）
+static bool IsReportName(const char *name) {
+    size_t len = strlen(name);
+    return len > 10 && strncmp(name, "crash-", 6) == 0 && strcmp(name + len - 4, ".log") == 0;
+}
+
+std::string CrashStorage::m_logDir;
+int CrashStorage::m_dirFd = -1;
+std::atomic<int> CrashStorage::m_manifestFd(-1);
+uint64_t CrashStorage::m_maxBytes = CrashStorage::kDefaultMaxBytes;
+uint32_t CrashStorage::m_maxCount = CrashStorage::kDefaultMaxCount;
+std::vector<CrashStorage::Entry> CrashStorage::m_entries;
+pthread_mutex_t CrashStorage::m_mutex = PTHREAD_MUTEX_INITIALIZER;
+std::string CrashStorage::m_pendingDir;
+char CrashStorage::m_pendingManifest[512] = {};
+bool CrashStorage::m_initPending = false;
+pthread_cond_t CrashStorage::m_ready = PTHREAD_COND_INITIALIZER;
+
+// 无符号整数转十进制（异步信号安全，不使用snprintf）
+static size_t FormatNumber(char *buf, uint64_t value) {
+    char tmp[24];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value);
+    for (size_t i = 0; i < n; ++i) {
+        buf[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+void CrashStorage::Prepare(const std::string &logDir) {
+    std::string dir = logDir;
+    while (dir.size() > 1 && dir.back() == '/') {
+        dir.pop_back();
+    }
+    std::string path = dir + "/" + kManifestName;
+    pthread_mutex_lock(&m_mutex);
+    m_pendingDir = dir;
+    if (path.size() < sizeof(m_pendingManifest)) {
+        memcpy(m_pendingManifest, path.c_str(), path.size() + 1);
+    }
+    m_initPending = true;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void CrashStorage::WaitReady() {
+    if (!m_initPending) {
+        return;
+    }
+    // 兜底：延迟加载迟迟不完成时不让调用方永久阻塞，按当前（可能为空的）状态继续
+    timespec deadline{};
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += kReadyTimeoutSec;
+    while (m_initPending) {
+        if (pthread_cond_timedwait(&m_ready, &m_mutex, &deadline) == ETIMEDOUT) {
+            log_utils::error("AndCrash", "CrashStorage wait ready timeout");
+            return;
+        }
+    }
+}
+
+bool CrashStorage::InitPrepared() {
+    pthread_mutex_lock(&m_mutex);
+    std::string dir = m_pendingDir;
+    pthread_mutex_unlock(&m_mutex);
+    return Init(dir);
+}
+
+bool CrashStorage::Init(const std::string &logDir) {
+    pthread_mutex_lock(&m_mutex);
+    if (m_dirFd != -1) {
+        close(m_dirFd);
+    }
+    int oldManifest = m_manifestFd.exchange(-1);
+    if (oldManifest != -1) {
+        close(oldManifest);
+    }
+    m_logDir = logDir;
+    while (m_logDir.size() > 1 && m_logDir.back() == '/') {
+        m_logDir.pop_back();
+    }
+    m_dirFd = open(m_logDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (m_dirFd == -1) {
+        log_utils::error("AndCrash", "CrashStorage open dir failed: %s", m_logDir.c_str());
+    } else {
+        // manifest不存在时（首次运行/被外部删除）才扫描一次目录
+        if (!Load()) {
+            Rebuild();
+        }
+        Evict();
+        Save();
+    }
+    m_initPending = false;
+    pthread_cond_broadcast(&m_ready);
+    pthread_mutex_unlock(&m_mutex);
+    return m_dirFd != -1;
+}
+
+void CrashStorage::SetQuota(uint64_t maxBytes, uint32_t maxCount) {
+    pthread_mutex_lock(&m_mutex);
+    m_maxBytes = maxBytes;
+    m_maxCount = maxCount;
+    if (m_dirFd != -1) {
+        Evict();
+        Save();
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void CrashStorage::Append(const char *name, uint64_t size) {
+    struct timespec now{};
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    char line[320];
+    size_t n = FormatNumber(line, (uint64_t) now.tv_sec);
+    line[n++] = ' ';
+    n += FormatNumber(line + n, size);
+    line[n++] = ' ';
+    size_t nameLen = strlen(name);
+    if (n + nameLen + 1 > sizeof(line)) {
+        return;
+    }
+    memcpy(line + n, name, nameLen);
+    n += nameLen;
+    line[n++] = '\n';
+    const int manifestFd = m_manifestFd.load(std::memory_order_acquire);
+    int fd = manifestFd;
+    if (fd == -1) {
+        // Init还在后台执行：manifest不存在时不创建，下次启动Rebuild扫描目录即可找回
+        fd = m_pendingManifest[0] ? open(m_pendingManifest, O_WRONLY | O_APPEND | O_CLOEXEC) : -1;
+        if (fd == -1) {
+            return;
+        }
+    }
+    // O_APPEND单次write，不会与其他进程的记录交错
+    write(fd, line, n);
+    if (fd != manifestFd) {
+        close(fd);
+    }
+}
+
+std::vector<std::string> CrashStorage::List() {
+    std::vector<std::string> paths;
+    pthread_mutex_lock(&m_mutex);
+    WaitReady();
+    paths.reserve(m_entries.size());
+    for (const Entry &e: m_entries) {
+        paths.push_back(m_logDir + "/" + e.name);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return paths;
+}
+
+int CrashStorage::Remove(const std::string &name) {
+    pthread_mutex_lock(&m_mutex);
+    WaitReady();
+    // 目录打开失败（或等待加载超时）时没有目录fd，按完整路径删除
+    const std::string &dir = m_logDir.empty() ? m_pendingDir : m_logDir;
+    int result = m_dirFd != -1 ? unlinkat(m_dirFd, name.c_str(), 0)
+                               : unlink((dir + "/" + name).c_str());
+    auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                           [&name](const Entry &e) { return e.name == name; });
+    if (it != m_entries.end()) {
+        m_entries.erase(it);
+        Save();
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return result;
+}
+
+int CrashStorage::RemoveAll() {
+    pthread_mutex_lock(&m_mutex);
+    WaitReady();
+    int result = -1;
+    int fd = m_dirFd == -1 ? -1 : openat(m_dirFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = fd == -1 ? nullptr : fdopendir(fd);
+    if (dir) {
+        // 按文件名匹配而不是按manifest删除，没有记录到manifest的报告也一起删掉
+        result = 0;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (IsReportName(entry->d_name) && unlinkat(m_dirFd, entry->d_name, 0) != 0) {
+                result = -1;
+            }
+        }
+        closedir(dir);
+        m_entries.clear();
+        Save();
+    } else if (fd != -1) {
+        close(fd);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return result;
+}
+
+int CrashStorage::RemoveDirectory(int parentFd, const char *name) {
+    int fd = openat(parentFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) {
+        log_utils::error("AndCrash", "无法打开目录: %s", name);
+        return -1;
+    }
+    ClearDirectory(fd);
+    if (unlinkat(parentFd, name, AT_REMOVEDIR) != 0) {
+        log_utils::error("AndCrash", "无法删除目录: %s", name);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 删除目录fd下的所有条目（fd由本函数关闭）
+ */
+void CrashStorage::ClearDirectory(int dirFd) {
+    DIR *dir = fdopendir(dirFd);
+    if (!dir) {
+        close(dirFd);
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (entry->d_type == DT_DIR) {
+            RemoveDirectory(dirfd(dir), entry->d_name);
+        } else if (unlinkat(dirfd(dir), entry->d_name, 0) != 0) {
+            log_utils::error("AndCrash", "无法删除文件: %s", entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * 读取manifest，只对manifest中的条目做fstatat校验（条目数受配额限制）
+ */
+bool CrashStorage::Load() {
+    m_entries.clear();
+    int fd = openat(m_dirFd, kManifestName, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    std::string content;
+    char buf[4096];
+    ssize_t bytes;
+    while ((bytes = read(fd, buf, sizeof(buf))) > 0) {
+        content.append(buf, (size_t) bytes);
+    }
+    struct stat manifestSt{};
+    fstat(fd, &manifestSt);
+    close(fd);
+
+    std::unordered_map<std::string, size_t> index;
+    size_t pos = 0;
+    while (pos < content.size()) {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos) {
+            break;  // 最后一行不完整（写入过程中进程被杀），丢弃
+        }
+        std::string line = content.substr(pos, end - pos);
+        pos = end + 1;
+
+        char *cursor = nullptr;
+        Entry entry{};
+        entry.time = strtoll(line.c_str(), &cursor, 10);
+        if (*cursor != ' ') continue;
+        entry.size = strtoull(cursor + 1, &cursor, 10);
+        if (*cursor != ' ') continue;
+        entry.name = cursor + 1;
+        if (entry.name.empty() || entry.name.find('/') != std::string::npos) continue;
+
+        // 文件可能已被Java层直接删除
+        struct stat st{};
+        if (fstatat(m_dirFd, entry.name.c_str(), &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        entry.size = (uint64_t) st.st_size;
+        auto it = index.find(entry.name);
+        if (it != index.end()) {
+            m_entries[it->second] = entry;
+        } else {
+            index[entry.name] = m_entries.size();
+            m_entries.push_back(entry);
+        }
+    }
+    // Save后会把manifest的mtime刷到目录之后，Append也会更新它；目录更新（新建报告）但manifest没跟上时，
+    // 说明有报告没记进来（manifest还不存在时写下的、Init完成前追加失败的），补扫一次目录
+    struct stat dirSt{};
+    if (fstat(m_dirFd, &dirSt) == 0
+        && (dirSt.st_mtim.tv_sec > manifestSt.st_mtim.tv_sec
+            || (dirSt.st_mtim.tv_sec == manifestSt.st_mtim.tv_sec
+                && dirSt.st_mtim.tv_nsec > manifestSt.st_mtim.tv_nsec))) {
+        ScanDirectory();
+    }
+    return true;
+}
+
+void CrashStorage::Rebuild() {
+    m_entries.clear();
+    ScanDirectory();
+}
+
+void CrashStorage::ScanDirectory() {
+    int fd = openat(m_dirFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = fd == -1 ? nullptr : fdopendir(fd);
+    if (!dir) {
+        if (fd != -1) close(fd);
+        return;
+    }
+    std::unordered_set<std::string> known;
+    for (const Entry &e: m_entries) {
+        known.insert(e.name);
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (!IsReportName(entry->d_name) || known.count(entry->d_name)) {
+            continue;
+        }
+        struct stat st{};
+        if (fstatat(m_dirFd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        m_entries.push_back({(int64_t) st.st_mtime, (uint64_t) st.st_size, entry->d_name});
+    }
+    closedir(dir);
+}
+
+/**
+ * 按时间从旧到新淘汰，直到满足字节数和文件数配额
+ */
+void CrashStorage::Evict() {
+    std::stable_sort(m_entries.begin(), m_entries.end(),
+                     [](const Entry &a, const Entry &b) { return a.time < b.time; });
+    uint64_t total = 0;
+    for (const Entry &e: m_entries) {
+        total += e.size;
+    }
+    size_t evicted = 0;
+    while (evicted < m_entries.size()
+           && (m_entries.size() - evicted > m_maxCount || total > m_maxBytes)) {
+        const Entry &e = m_entries[evicted++];
+        unlinkat(m_dirFd, e.name.c_str(), 0);
+        total -= e.size;
+    }
+    if (evicted > 0) {
+        log_utils::debug("AndCrash", "CrashStorage evicted %zu logs", evicted);
+        m_entries.erase(m_entries.begin(), m_entries.begin() + (long) evicted);
+    }
+}
+
+/**
+ * 压缩重写manifest（tmp + renameat保证原子替换），写好的tmp fd直接作为新的追加fd。
+ * 信号处理函数随时可能读取m_manifestFd，切换时不能出现已关闭或被复用的fd号
+ */
+void CrashStorage::Save() {
+    std::string content;
+    for (const Entry &e: m_entries) {
+        char prefix[48];
+        size_t n = FormatNumber(prefix, (uint64_t) e.time);
+        prefix[n++] = ' ';
+        n += FormatNumber(prefix + n, e.size);
+        prefix[n++] = ' ';
+        content.append(prefix, n).append(e.name).append("\n");
+    }
+    int fd = openat(m_dirFd, kManifestTmpName, O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd == -1) {
+        return;
+    }
+    bool ok = write(fd, content.data(), content.size()) == (ssize_t) content.size();
+    if (!ok || renameat(m_dirFd, kManifestTmpName, m_dirFd, kManifestName) != 0) {
+        close(fd);
+        unlinkat(m_dirFd, kManifestTmpName, 0);
+        return;
+    }
+    // rename更新了目录的mtime，manifest的mtime要在它之后，Load才不会误判为有未记录的报告
+    futimens(fd, nullptr);
+    int oldFd = m_manifestFd.load();
+    if (oldFd != -1 && dup3(fd, oldFd, O_CLOEXEC) == oldFd) {
+        // 原fd号直接指向新文件，并发的Append拿到的fd号始终有效
+        close(fd);
+    } else {
+        oldFd = m_manifestFd.exchange(fd, std::memory_order_release);
+        if (oldFd != -1) {
+            close(oldFd);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef ANDROID_CRASH_STORAGE_H
+#define ANDROID_CRASH_STORAGE_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <pthread.h>
+
+/**
+ * 崩溃日志目录管理
+ *
+ * 目录下维护一个manifest（每行：时间 大小 文件名），启动时只读manifest，
+ * 不再扫描整个目录；超过字节数/文件数配额时从最旧的日志开始淘汰。
+ * 所有文件操作都基于目录fd（openat/unlinkat/renameat）
+ */
+class CrashStorage final {
+public:
+    static constexpr uint64_t kDefaultMaxBytes = 10 * 1024 * 1024;
+    static constexpr uint32_t kDefaultMaxCount = 20;
+    static constexpr int kReadyTimeoutSec = 5;
+
+    // 只记录目录和manifest路径（不做IO），Init完成前发生崩溃时Append按路径追加；
+    // 之后List/Remove/RemoveAll会等待Init完成（最多kReadyTimeoutSec）
+    static void Prepare(const std::string &logDir);
+
+    // 用Prepare记录的目录执行Init（后台线程调用，不读取调用方可能正在修改的字符串）
+    static bool InitPrepared();
+
+    // 打开目录并加载manifest，同时执行一次配额淘汰
+    static bool Init(const std::string &logDir);
+
+    // 修改配额并立即淘汰
+    static void SetQuota(uint64_t maxBytes, uint32_t maxCount);
+
+    // 信号处理函数中调用：追加一条记录（异步信号安全）
+    static void Append(const char *name, uint64_t size);
+
+    // 所有日志的完整路径，旧的在前
+    static std::vector<std::string> List();
+
+    static int Remove(const std::string &name);
+
+    // 批量删除目录下所有crash-*.log（包括manifest中没有记录的）
+    static int RemoveAll();
+
+    // 递归删除parentFd下的目录name
+    static int RemoveDirectory(int parentFd, const char *name);
+
+    CrashStorage(const CrashStorage &) = delete;
+
+    void operator=(const CrashStorage &) = delete;
+
+private:
+    struct Entry {
+        int64_t time;
+        uint64_t size;
+        std::string name;
+    };
+
+    static bool Load();
+
+    static void Rebuild();
+
+    // 把目录中manifest没有记录的报告补进m_entries
+    static void ScanDirectory();
+
+    static void Evict();
+
+    static void Save();
+
+    static void ClearDirectory(int dirFd);
+
+    // 持有m_mutex时调用，最多等待kReadyTimeoutSec
+    static void WaitReady();
+
+    static std::string m_logDir;
+    static int m_dirFd;
+    // 信号处理函数中不加锁读取，只在完整写好新manifest后才切换
+    static std::atomic<int> m_manifestFd;
+    static uint64_t m_maxBytes;
+    static uint32_t m_maxCount;
+    static std::vector<Entry> m_entries;
+    static pthread_mutex_t m_mutex;
+    static std::string m_pendingDir;
+    static char m_pendingManifest[512];
+    static bool m_initPending;
+    static pthread_cond_t m_ready;
+};
+
+#endif //ANDROID_CRASH_STORAGE_H
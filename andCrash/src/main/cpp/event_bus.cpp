@@ -0,0 +1,176 @@
+#include "event_bus.h"
+#include <cerrno>
+#include <ctime>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include "core/include/log_utils.h"
+
+EventBus::Slot EventBus::m_slots[EventBus::kCapacity];
+std::atomic<uint64_t> EventBus::m_tail(0);
+uint64_t EventBus::m_head = 0;
+std::atomic<uint64_t> EventBus::m_posted(0);
+std::atomic<uint64_t> EventBus::m_delivered(0);
+std::atomic<uint64_t> EventBus::m_dropped(0);
+std::atomic<EventSink> EventBus::m_sink(nullptr);
+std::atomic_int EventBus::m_eventFd(-1);
+std::atomic<pid_t> EventBus::m_dispatcherTid(0);
+std::atomic<void (*)()> EventBus::m_task(nullptr);
+
+// 其他so（libapm等）通过dlsym找到并投递事件
+extern "C" __attribute__((visibility("default")))
+bool and_crash_post_event(uint32_t type, int64_t value, const char *detail) {
+    return EventBus::Post(static_cast<EventType>(type), value, detail);
+}
+
+bool EventBus::Start(void (*task)()) {
+    if (task) {
+        m_task.store(task);
+    }
+    if (m_eventFd.load() != -1) {
+        // 分发线程已在运行：唤醒它执行task
+        Wake();
+        return true;
+    }
+    int fd = eventfd(0, EFD_CLOEXEC);
+    if (fd == -1) {
+        m_task.compare_exchange_strong(task, nullptr);
+        return false;
+    }
+    int expected = -1;
+    if (!m_eventFd.compare_exchange_strong(expected, fd)) {
+        close(fd);
+        Wake();
+        return true;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, DispatchThread, nullptr) != 0) {
+        log_utils::error("AndCrash", "EventBus dispatcher create failed");
+        // 撤销，之后的Start可以重试
+        m_task.compare_exchange_strong(task, nullptr);
+        m_eventFd.store(-1);
+        close(fd);
+        return false;
+    }
+    pthread_detach(thread);
+    return true;
+}
+
+void EventBus::Wake() {
+    int fd = m_eventFd.load(std::memory_order_relaxed);
+    if (fd != -1) {
+        uint64_t one = 1;
+        write(fd, &one, sizeof(one));
+    }
+}
+
+void EventBus::SetSink(EventSink sink) {
+    m_sink.store(sink);
+}
+
+bool EventBus::Post(EventType type, int64_t value, const char *detail) {
+    uint64_t pos = m_tail.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+        slot = &m_slots[pos & (kCapacity - 1)];
+        uint64_t lap = 2 * (pos / kCapacity);
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        if (seq == lap) {
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (seq < lap) {
+            // 上一圈的事件还没被取走：队列满
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    Event &event = slot->event;
+    struct timespec now{};
+    clock_gettime(CLOCK_REALTIME, &now);
+    event.type = static_cast<uint32_t>(type);
+    event.tid = (int32_t) syscall(SYS_gettid);
+    event.timeMs = (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    event.value = value;
+    size_t n = 0;
+    while (detail && detail[n] && n < sizeof(event.detail) - 1) {
+        event.detail[n] = detail[n];
+        n++;
+    }
+    event.detail[n] = '\0';
+    slot->seq.store(2 * (pos / kCapacity) + 1, std::memory_order_release);
+    m_posted.fetch_add(1, std::memory_order_release);
+    Wake();
+    return true;
+}
+
+size_t EventBus::Drain(Event *out, size_t max) {
+    size_t n = 0;
+    while (n < max) {
+        Slot &slot = m_slots[m_head & (kCapacity - 1)];
+        uint64_t lap = 2 * (m_head / kCapacity);
+        if (slot.seq.load(std::memory_order_acquire) != lap + 1) {
+            break;
+        }
+        out[n++] = slot.event;
+        // 交还给下一圈的生产者
+        slot.seq.store(lap + 2, std::memory_order_release);
+        m_head++;
+    }
+    return n;
+}
+
+bool EventBus::Flush(int timeoutMs) {
+    if (m_eventFd.load() == -1 || m_dispatcherTid.load() == (pid_t) syscall(SYS_gettid)) {
+        return false;
+    }
+    uint64_t target = m_posted.load(std::memory_order_acquire);
+    struct timespec delay = {0, 1000 * 1000};
+    for (int waited = 0; m_delivered.load(std::memory_order_acquire) < target; ++waited) {
+        if (waited >= timeoutMs) {
+            return false;
+        }
+        nanosleep(&delay, nullptr);
+    }
+    return true;
+}
+
+uint64_t EventBus::Dropped() {
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+void *EventBus::DispatchThread(void * /*arg*/) {
+    m_dispatcherTid.store((pid_t) syscall(SYS_gettid));
+    Event batch[kMaxBatch];
+    int fd = m_eventFd.load();
+    bool readFailed = false;
+    while (true) {
+        void (*task)() = m_task.exchange(nullptr);
+        if (task) {
+            task();
+        }
+        // Start之前投递的事件也在这里取走
+        size_t n;
+        while ((n = Drain(batch, kMaxBatch)) > 0) {
+            EventSink sink = m_sink.load();
+            if (sink) {
+                sink(batch, n);
+            }
+            m_delivered.fetch_add(n, std::memory_order_release);
+        }
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) < 0 && errno != EINTR) {
+            // 分发线程不能退出（Start会认为它还在运行，事件只会堆积到被丢弃），退化为轮询
+            if (!readFailed) {
+                log_utils::error("AndCrash", "EventBus read eventfd failed: %d, fall back to polling", errno);
+                readFailed = true;
+            }
+            struct timespec delay = {0, 10 * 1000 * 1000};
+            nanosleep(&delay, nullptr);
+        }
+    }
+}
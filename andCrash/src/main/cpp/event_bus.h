@@ -0,0 +1,88 @@
+#ifndef ANDROID_EVENT_BUS_H
+#define ANDROID_EVENT_BUS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+enum class EventType : uint32_t {
+    Crash = 1,            // value: 信号，detail: 崩溃报告路径
+    Anr = 2,
+    MemoryThreshold = 3,  // value: 当前内存字节数
+    LeakDetected = 4,     // value: 泄漏实例数，detail: 类名
+};
+
+// 定长事件记录，Java侧（NativeEventBus）按同样的布局从DirectByteBuffer读取
+struct Event {
+    uint32_t type;
+    int32_t tid;
+    int64_t timeMs;
+    int64_t value;
+    char detail[256];
+};
+
+// 分发线程上批量回调
+typedef void (*EventSink)(const Event *events, size_t count);
+
+/**
+ * native -> Java 事件总线
+ *
+ * 定长无锁MPSC环形队列（静态存储，不分配内存），Post可在任意线程、包括信号处理函数中调用；
+ * 唯一的分发线程被eventfd唤醒后一次取出多条，交给sink批量投递（Java侧一批只有一次JNI调用）。
+ * 队列满时丢弃并计数。其他so通过导出的and_crash_post_event投递。
+ * 限制：信号处理函数打断了同一线程上正在进行的Post时，它投递的事件要等被打断的那条写完才会被取走。
+ */
+class EventBus final {
+public:
+    static constexpr size_t kCapacity = 256;  // 2的幂
+    static constexpr size_t kMaxBatch = 32;
+
+    // 首次调用创建eventfd和分发线程；每次调用的task都会在分发线程上执行一次
+    // （尚未执行时再次调用只保留最后一个）。task可为nullptr。
+    // 创建失败返回false，task不会执行
+    static bool Start(void (*task)());
+
+    static void SetSink(EventSink sink);
+
+    // 异步信号安全
+    static bool Post(EventType type, int64_t value, const char *detail);
+
+    // 等待此前投递的事件全部分发完成（异步信号安全），超时或在分发线程上调用返回false
+    static bool Flush(int timeoutMs);
+
+    static uint64_t Dropped();
+
+    EventBus(const EventBus &) = delete;
+
+    void operator=(const EventBus &) = delete;
+
+private:
+    // seq == 2 * 圈数：可写；2 * 圈数 + 1：已写入待取。零初始化即为第0圈可写
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        Event event;
+    };
+
+    static size_t Drain(Event *out, size_t max);
+
+    static void *DispatchThread(void *arg);
+
+    static void Wake();
+
+    static Slot m_slots[kCapacity];
+    static std::atomic<uint64_t> m_tail;
+    static uint64_t m_head;                 // 只由分发线程访问
+    static std::atomic<uint64_t> m_posted;
+    static std::atomic<uint64_t> m_delivered;
+    static std::atomic<uint64_t> m_dropped;
+    static std::atomic<EventSink> m_sink;
+    static std::atomic_int m_eventFd;
+    static std::atomic<pid_t> m_dispatcherTid;
+    static std::atomic<void (*)()> m_task;
+
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Post must stay lock-free in signal handlers");
+};
+
+#endif //ANDROID_EVENT_BUS_H
@@ -0,0 +1,170 @@
+#include "got_hook.h"
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <elf.h>
+#include <link.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__LP64__)
+#define ELF_R_SYM(info) ELF64_R_SYM(info)
+#define ELF_R_TYPE(info) ELF64_R_TYPE(info)
+#else
+#define ELF_R_SYM(info) ELF32_R_SYM(info)
+#define ELF_R_TYPE(info) ELF32_R_TYPE(info)
+#endif
+
+#if defined(__aarch64__)
+static const uint32_t kJumpSlot = R_AARCH64_JUMP_SLOT;
+static const uint32_t kGlobDat = R_AARCH64_GLOB_DAT;
+#elif defined(__arm__)
+static const uint32_t kJumpSlot = R_ARM_JUMP_SLOT;
+static const uint32_t kGlobDat = R_ARM_GLOB_DAT;
+#elif defined(__x86_64__)
+static const uint32_t kJumpSlot = R_X86_64_JUMP_SLOT;
+static const uint32_t kGlobDat = R_X86_64_GLOB_DAT;
+#elif defined(__i386__)
+static const uint32_t kJumpSlot = R_386_JMP_SLOT;
+static const uint32_t kGlobDat = R_386_GLOB_DAT;
+#endif
+
+struct HookContext {
+    const char *symbol;
+    void *replacement;
+    GotHookFilter filter;
+    const char *mainPath;
+    int patched;
+};
+
+template<typename Rel>
+static void PatchRelocations(const dl_phdr_info *info, const Rel *rel, size_t size,
+                             const ElfW(Sym) *symtab, const char *strtab,
+                             uintptr_t relroStart, uintptr_t relroEnd, HookContext *ctx) {
+    const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < size / sizeof(Rel); ++i) {
+        uint32_t type = (uint32_t) ELF_R_TYPE(rel[i].r_info);
+        if (type != kJumpSlot && type != kGlobDat) {
+            continue;
+        }
+        const ElfW(Sym) &sym = symtab[ELF_R_SYM(rel[i].r_info)];
+        if (strcmp(strtab + sym.st_name, ctx->symbol) != 0) {
+            continue;
+        }
+        auto *slot = reinterpret_cast<void **>(info->dlpi_addr + rel[i].r_offset);
+        if (*slot == ctx->replacement) {
+            continue;
+        }
+        auto slotAddr = reinterpret_cast<uintptr_t>(slot);
+        void *page = reinterpret_cast<void *>(slotAddr & ~(pageSize - 1));
+        // full RELRO下GOT只读，改完恢复
+        if (mprotect(page, pageSize, PROT_READ | PROT_WRITE) != 0) {
+            continue;
+        }
+        __atomic_store_n(slot, ctx->replacement, __ATOMIC_RELEASE);
+        if (slotAddr >= relroStart && slotAddr < relroEnd) {
+            mprotect(page, pageSize, PROT_READ);
+        }
+        ctx->patched++;
+    }
+}
+
+static int PatchObject(struct dl_phdr_info *info, size_t, void *data) {
+    auto *ctx = static_cast<HookContext *>(data);
+    // glibc下主程序的dlpi_name为空串
+    const char *path = info->dlpi_name && info->dlpi_name[0] ? info->dlpi_name : ctx->mainPath;
+    if (ctx->filter && !ctx->filter(path)) {
+        return 0;
+    }
+    const ElfW(Dyn) *dynamic = nullptr;
+    uintptr_t relroStart = 0, relroEnd = 0;
+    for (int i = 0; i < info->dlpi_phnum; ++i) {
+        const ElfW(Phdr) &phdr = info->dlpi_phdr[i];
+        if (phdr.p_type == PT_DYNAMIC) {
+            dynamic = reinterpret_cast<const ElfW(Dyn) *>(info->dlpi_addr + phdr.p_vaddr);
+        } else if (phdr.p_type == PT_GNU_RELRO) {
+            relroStart = info->dlpi_addr + phdr.p_vaddr;
+            relroEnd = relroStart + phdr.p_memsz;
+        }
+    }
+    if (!dynamic) {
+        return 0;
+    }
+    // glibc会把d_ptr重定位为绝对地址，bionic不会
+    auto resolve = [info](ElfW(Addr) ptr) -> uintptr_t {
+        return ptr < info->dlpi_addr ? info->dlpi_addr + ptr : ptr;
+    };
+    const ElfW(Sym) *symtab = nullptr;
+    const char *strtab = nullptr;
+    uintptr_t jmprel = 0, rel = 0, rela = 0;
+    size_t jmprelSize = 0, relSize = 0, relaSize = 0;
+    ElfW(Sxword) pltRelType = 0;
+    for (const ElfW(Dyn) *d = dynamic; d->d_tag != DT_NULL; ++d) {
+        switch (d->d_tag) {
+            case DT_SYMTAB:
+                symtab = reinterpret_cast<const ElfW(Sym) *>(resolve(d->d_un.d_ptr));
+                break;
+            case DT_STRTAB:
+                strtab = reinterpret_cast<const char *>(resolve(d->d_un.d_ptr));
+                break;
+            case DT_JMPREL:
+                jmprel = resolve(d->d_un.d_ptr);
+                break;
+            case DT_PLTRELSZ:
+                jmprelSize = d->d_un.d_val;
+                break;
+            case DT_PLTREL:
+                pltRelType = (ElfW(Sxword)) d->d_un.d_val;
+                break;
+            case DT_REL:
+                rel = resolve(d->d_un.d_ptr);
+                break;
+            case DT_RELSZ:
+                relSize = d->d_un.d_val;
+                break;
+            case DT_RELA:
+                rela = resolve(d->d_un.d_ptr);
+                break;
+            case DT_RELASZ:
+                relaSize = d->d_un.d_val;
+                break;
+            default:
+                break;
+        }
+    }
+    if (!symtab || !strtab) {
+        return 0;
+    }
+    if (jmprel && pltRelType == DT_RELA) {
+        PatchRelocations(info, reinterpret_cast<const ElfW(Rela) *>(jmprel), jmprelSize, symtab, strtab,
+                         relroStart, relroEnd, ctx);
+    } else if (jmprel) {
+        PatchRelocations(info, reinterpret_cast<const ElfW(Rel) *>(jmprel), jmprelSize, symtab, strtab,
+                         relroStart, relroEnd, ctx);
+    }
+    // -fno-plt或取了函数地址时走GLOB_DAT（Android打包重定位DT_ANDROID_REL*不处理）
+    if (rela) {
+        PatchRelocations(info, reinterpret_cast<const ElfW(Rela) *>(rela), relaSize, symtab, strtab,
+                         relroStart, relroEnd, ctx);
+    }
+    if (rel) {
+        PatchRelocations(info, reinterpret_cast<const ElfW(Rel) *>(rel), relSize, symtab, strtab,
+                         relroStart, relroEnd, ctx);
+    }
+    return 0;
+}
+
+int GotHook::Replace(const char *symbol, void *replacement, GotHookFilter filter) {
+    char mainPath[PATH_MAX] = {};
+    ssize_t n = readlink("/proc/self/exe", mainPath, sizeof(mainPath) - 1);
+    mainPath[n > 0 ? n : 0] = '\0';
+    HookContext ctx{symbol, replacement, filter, mainPath, 0};
+    dl_iterate_phdr(PatchObject, &ctx);
+    return ctx.patched;
+}
+
+// 其他so（libapm）通过dlsym找到并替换自己关心的符号
+extern "C" __attribute__((visibility("default")))
+int and_crash_replace_got(const char *symbol, void *replacement, GotHookFilter filter) {
+    return GotHook::Replace(symbol, replacement, filter);
+}
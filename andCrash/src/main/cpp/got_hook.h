@@ -0,0 +1,24 @@
+#ifndef ANDROID_GOT_HOOK_H
+#define ANDROID_GOT_HOOK_H
+
+// 按so路径决定是否替换，返回true表示替换
+typedef bool (*GotHookFilter)(const char *path);
+
+/**
+ * GOT/PLT hook
+ *
+ * 遍历已加载的so（dl_iterate_phdr），把JUMP_SLOT/GLOB_DAT重定位中指定符号的GOT项改为replacement，
+ * full RELRO的页改完后恢复只读。只影响调用时已加载的so，so内部的直接调用也不受影响。
+ * 其他so（libapm）通过导出的and_crash_replace_got使用
+ */
+class GotHook final {
+public:
+    // filter为空时替换所有so，返回替换的GOT项数量
+    static int Replace(const char *symbol, void *replacement, GotHookFilter filter);
+
+    GotHook(const GotHook &) = delete;
+
+    void operator=(const GotHook &) = delete;
+};
+
+#endif //ANDROID_GOT_HOOK_H
@@ -23,23 +23,78 @@
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <dirent.h>
-#include <jni.h>
-#include "jni_env_deleter.h"
+#include "crash_storage.h"
+#include "event_bus.h"
+#include "signal_stack_pool.h"
 #include "core/include/log_utils.h"
 //mmap
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 
 struct sigaction CrashHandler::old_sa[NSIG];
 std::string CrashHandler::m_logDir;
 std::string CrashHandler::m_version;
 std::atomic_bool CrashHandler::m_crashHandling(false);
+std::atomic<FaultDescriber> CrashHandler::m_faultDescriber(nullptr);
+std::atomic<uint64_t> CrashHandler::m_initCostNs(0);
+std::atomic<uint64_t> CrashHandler::m_deferredInitCostNs(0);
 
-void CrashHandler::Init(JNIEnv *env, const std::string &logDir, jobject callback) {
+// 崩溃事件交给Java的最长等待时间
+static const int kCrashFlushTimeoutMs = 200;
+
+static uint64_t NowNs() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+// 其他so（libapm）通过dlsym找到并注册故障描述回调
+extern "C" __attribute__((visibility("default")))
+void and_crash_register_fault_describer(FaultDescriber describer) {
+    CrashHandler::SetFaultDescriber(describer);
+}
+
+void CrashHandler::SetFaultDescriber(FaultDescriber describer) {
+    m_faultDescriber.store(describer);
+}
+
+/**
+ * 启动主线程上只做捕获崩溃必需的部分：备用栈 + 信号处理函数 + 启动事件分发线程，
+ * 目录/manifest加载和pthread_create hook在分发线程中完成（见DeferredInit），每次Init都会执行一次
+ */
+void CrashHandler::Init(const std::string &logDir) {
+    uint64_t start = NowNs();
     m_logDir = logDir;
+    CrashStorage::Prepare(logDir);
     setupAlternateStack();
     InstallSignalHandlers();
-    ThreadInit(env, callback);
+    if (!EventBus::Start(DeferredInit)) {
+        // 没有分发线程时在当前线程完成，否则CrashStorage会一直等待加载
+        DeferredInit();
+    }
+    m_initCostNs.store(NowNs() - start);
+}
+
+void CrashHandler::DeferredInit() {
+    uint64_t start = NowNs();
+    // 分发线程本身在hook之前创建
+    SignalStackPool::AttachCurrentThread();
+    // Init返回后调用方线程仍可能修改m_logDir，这里只用Prepare时记下的副本
+    CrashStorage::InitPrepared();
+    int hooked = SignalStackPool::HookPthreadCreate();
+    uint64_t deferred = NowNs() - start;
+    m_deferredInitCostNs.store(deferred);
+    log_utils::info("AndCrash", "Init %" PRIu64 "us on caller, %" PRIu64 "us deferred, %d pthread_create hooked",
+                    m_initCostNs.load() / 1000, deferred / 1000, hooked);
+}
+
+uint64_t CrashHandler::InitCostNs() {
+    return m_initCostNs.load();
+}
+
+uint64_t CrashHandler::DeferredInitCostNs() {
+    return m_deferredInitCostNs.load();
 }
 
 /**
@@ -63,77 +118,11 @@ void CrashHandler::InstallSignalHandlers() {
 }
 
 /**
- * 备用信号栈
+ * 备用信号栈：预留栈池并给当前线程挂栈，之后创建的线程由pthread_create hook挂上
  */
 void CrashHandler::setupAlternateStack() {
-    // 备用信号栈
-    stack_t ss{};
-    //
-    ss.ss_sp = mmap(nullptr, SIGSTKSZ, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-    if (!ss.ss_sp) {
-        return;
-    }
-    ss.ss_size = SIGSTKSZ;
-    ss.ss_flags = 0;
-    if (ss.ss_sp != MAP_FAILED) {
-        sigaltstack(&ss, nullptr);
-    }
-}
-
-void CrashHandler::SetLogDir(const std::string &logDir) {
-    m_logDir = logDir;
-}
-
-/**
- * 创建event_fd和回调线程
- */
-void CrashHandler::ThreadInit(JNIEnv *env, jobject callback) {
-    log_utils::debug("AndCrash", "ThreadInit");
-    env->GetJavaVM(&g_vm);
-    // 线程安全 互斥锁
-    pthread_mutex_lock(&g_callbackMutex);
-
-    if (g_callback) {
-        env->DeleteGlobalRef(g_callback);
-    }
-    g_callback = env->NewGlobalRef(callback);
-
-    //释放互斥锁
-    pthread_mutex_unlock(&g_callbackMutex);
-
-    // 创建event_fd
-    g_eventFd = eventfd(0, EFD_NONBLOCK);
-
-    // 创建回调线程
-    pthread_create(&g_callbackThread, nullptr, CallbackThread, nullptr);
-    pthread_detach(g_callbackThread);
-}
-
-/**
- * 回调线程实现
- *
- * @param arg
- * @return
- */
-[[noreturn]] void *CrashHandler::CallbackThread(void *arg) {
-    //JNI线程中需要attach才可以使用JNIEnv
-    auto env_ptr = attachEnv(g_vm);
-    JNIEnv *env = env_ptr.get();
-    uint64_t eventCount;
-    while (true) {
-        if (read(g_eventFd, &eventCount, sizeof(eventCount)) > 0) {
-            pthread_mutex_lock(&g_callbackMutex);
-            if (g_callback) {
-                jclass callbackClass = env->GetObjectClass(g_callback);
-                jmethodID method = env->GetMethodID(callbackClass, "onCrashReport",
-                                                    "(Ljava/lang/String;)V");
-                jstring jPath = env->NewStringUTF(m_logDir.c_str());
-                env->CallVoidMethod(g_callback, method, jPath);
-                env->DeleteLocalRef(jPath);
-            }
-            close(g_eventFd);
-            pthread_mutex_unlock(&g_callbackMutex);
-        }
+    if (SignalStackPool::Init()) {
+        SignalStackPool::AttachCurrentThread();
     }
 }
 
@@ -159,17 +148,25 @@ void CrashHandler::SignalHandler(int sig, siginfo_t *info, void *ucontext) {
     // 关键数据采集
     DumpRegisters(ucontext, fd);    // 寄存器转储
     DumpStackTrace(ucontext, fd);   // 堆栈跟踪
+    FaultDescriber describer = m_faultDescriber.load();
+    if (describer) {
+        describer(info->si_addr, fd);  // 保护池中的堆错误：分配/释放栈
+    }
     DumpMemoryMaps(fd);             // 内存映射
+
+    // 记录到manifest，下次启动无需扫描目录
+    struct stat st{};
+    if (fstat(fd, &st) == 0) {
+        CrashStorage::Append(strrchr(logPath.c_str(), '/') + 1, (uint64_t) st.st_size);
+    }
     close(fd);  // 必须关闭文件描述符
 
     // 原子锁释放
     m_crashHandling.store(false);
 
-    NotifyJavaCallback(logPath);// 通知Java回调
-
-    // 休眠1毫秒等待文件写入完成
-    struct timespec delay = {0, 1000 * 1000}; // 0秒 + 1000000纳秒 = 1毫秒
-    nanosleep(&delay, nullptr);
+    // 带上实际报告路径通知Java，并等分发线程投递完（有上限，不能让进程卡住）
+    EventBus::Post(EventType::Crash, sig, logPath.c_str());
+    EventBus::Flush(kCrashFlushTimeoutMs);
 
     // 恢复默认信号处理并重新触发信号（确保进程终止）
     signal(sig, SIG_DFL);
@@ -179,12 +176,6 @@ void CrashHandler::SignalHandler(int sig, siginfo_t *info, void *ucontext) {
     kill(getpid(), sig);
 }
 
-// 通知event_fd函数  线程中read 阻塞
-void CrashHandler::NotifyJavaCallback(const std::string &crashLogPath) {
-    uint64_t value = 1;
-    write(g_eventFd, &value, sizeof(value));
-}
-
 void CrashHandler::DumpRegisters(void *ucontext, int fd) {
     auto *ctx = static_cast<ucontext_t *>(ucontext);
 
@@ -238,14 +229,15 @@ static _Unwind_Reason_Code UnwindCallback(
 }
 
 void CrashHandler::DumpStackTrace(void *ucontext, int fd) {
-    void *stack[128];  // 最多捕获128层堆栈
+    void *stack[128] = {};  // 最多捕获128层堆栈
     BacktraceState state{stack, stack + 128};
 
     // 使用libunwind进行堆栈展开
     _Unwind_Backtrace(UnwindCallback, &state);
 
     dprintf(fd, "\nStack Trace:\n");
-    for (size_t i = 0; stack[i]; ++i) {  // 遍历有效堆栈地址
+    const size_t count = state.current - stack;  // 栈满时stack[128]越界，按实际数量遍历
+    for (size_t i = 0; i < count; ++i) {  // 遍历有效堆栈地址
         Dl_info info{};
         if (dladdr(stack[i], &info)) {  // 解析符号信息
             const char *name = info.dli_sname ?: "??";  // 符号名或占位符
@@ -279,13 +271,12 @@ void CrashHandler::DumpMemoryMaps(int fd) {
 }
 
 std::string CrashHandler::GenerateCrashLogPath() {
-    // 生成日志路径（示例：/data/crash/20230315-143022.crash）
-
-
-    if (m_logDir.back() != '/') {
-        m_logDir.append("/");
+    // 生成日志路径（示例：/data/crash/crash-20230315-143022.log），不修改m_logDir
+    std::string path = m_logDir;
+    if (path.empty() || path.back() != '/') {
+        path.append("/");
     }
-    return m_logDir + "/" + "crash-" + GetCurrentTime() + ".log";
+    return path + "crash-" + GetCurrentTime() + ".log";
 }
 
 void CrashHandler::SetVersion(const std::string &version) {
@@ -293,51 +284,23 @@ void CrashHandler::SetVersion(const std::string &version) {
 }
 
 int CrashHandler::deleteLogFile(const std::string &crashLogFullPath) {
-    return unlink(crashLogFullPath.c_str());
-}
-
-int CrashHandler::removeDirectory(const std::string &crashLogPath) {
-    const char *path = crashLogPath.c_str();
-    DIR *dir = opendir(path);
-    if (!dir) {
-        __android_log_print(ANDROID_LOG_ERROR, "AndCrash", "无法打开目录: %s", path);
-        return -1;
-    }
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != nullptr) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue; // 跳过 . 和 ..
+    // 崩溃目录下的日志同步从manifest中移除
+    size_t slash = crashLogFullPath.find_last_of('/');
+    if (slash != std::string::npos) {
+        std::string dir = crashLogFullPath.substr(0, slash);
+        std::string logDir = m_logDir;
+        while (!logDir.empty() && logDir.back() == '/') {
+            logDir.pop_back();
         }
-
-        char full_path[PATH_MAX];
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-
-        if (entry->d_type == DT_DIR) {
-            // 递归删除子目录
-            if (removeDirectory(full_path) != 0) {
-                closedir(dir);
-                return -1;
-            }
-        } else {
-            // 删除文件
-            if (unlink(full_path) != 0) {
-                __android_log_print(ANDROID_LOG_ERROR, "AndCrash", "无法删除文件: %s",
-                                    full_path);
-                closedir(dir);
-                return -1;
-            }
+        if (dir == logDir) {
+            return CrashStorage::Remove(crashLogFullPath.substr(slash + 1));
         }
     }
+    return unlink(crashLogFullPath.c_str());
+}
 
-    closedir(dir);
-
-    // 删除空目录
-    if (rmdir(path) != 0) {
-        __android_log_print(ANDROID_LOG_ERROR, "AndCrash", "无法删除目录: %s", path);
-        return -1;
-    }
-    return 0;
+int CrashHandler::removeDirectory(const std::string &crashLogPath) {
+    return CrashStorage::RemoveDirectory(AT_FDCWD, crashLogPath.c_str());
 }
 
 std::string CrashHandler::GetCurrentTime() {
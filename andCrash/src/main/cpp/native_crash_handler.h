@@ -3,49 +3,43 @@
 
 #include <string>
 #include <atomic>
-#include <functional>  // 用于std::function回调
-#include <jni.h>
-#include <sys/eventfd.h>
-#include <pthread.h>
-
-// 新增全局变量
-static JavaVM *g_vm = nullptr;
-static jobject g_callback = nullptr;
-static pthread_mutex_t g_callbackMutex = PTHREAD_MUTEX_INITIALIZER;
-static int g_eventFd = -1;
-static pthread_t g_callbackThread;
+#include <csignal>
+#include <cstdint>
+
+// 故障描述回调：地址属于调用方管理的内存时写入额外诊断信息并返回true（需异步信号安全）
+typedef bool (*FaultDescriber)(void *faultAddr, int fd);
 
 class CrashHandler final {
 public:
-    // 初始化方法（线程安全）
-    static void Init(JNIEnv *env, const std::string &logDir, jobject callback);
+    // 初始化方法（线程安全）；崩溃通过EventBus投递给Java
+    static void Init(const std::string &logDir);
 
     // 设置应用版本信息
     static void SetVersion(const std::string &version);
 
-    static void SetLogDir(const std::string &logDir);
-
-    // 线程初始化方法
-    static void ThreadInit(JNIEnv *en, jobject callback);
-
-    // 线程执行函数声明  回调方法（线程安全）
-    [[noreturn]] static void *CallbackThread(void *arg);
-
-    // 通知Java回调方法
-    static void NotifyJavaCallback(const std::string &crashLogPath);
-
     static int deleteLogFile(const std::string &crashLogFullPath);
 
     static int removeDirectory(const std::string &crashLogPath);
 
     static void setupAlternateStack();
 
+    // Init在调用线程上的耗时；后台初始化（目录/manifest、pthread_create hook）的耗时，未完成时为0
+    static uint64_t InitCostNs();
+
+    static uint64_t DeferredInitCostNs();
+
+    // 注册故障描述回调（例如libapm的采样保护分配器）
+    static void SetFaultDescriber(FaultDescriber describer);
+
     // 删除拷贝构造函数和赋值运算符（单例模式）
     CrashHandler(const CrashHandler &) = delete;
 
     void operator=(const CrashHandler &) = delete;
 
 private:
+    // 不影响崩溃捕获的初始化，放到EventBus分发线程执行，不占启动主线程
+    static void DeferredInit();
+
     // 信号处理器安装方法
     static void InstallSignalHandlers();
 
@@ -70,6 +64,9 @@ private:
     static std::string m_logDir;         // 日志目录
     static std::string m_version;        // 应用版本
     static std::atomic_bool m_crashHandling; // 原子标志防止递归崩溃
+    static std::atomic<FaultDescriber> m_faultDescriber;
+    static std::atomic<uint64_t> m_initCostNs;
+    static std::atomic<uint64_t> m_deferredInitCostNs;
     static struct sigaction old_sa[NSIG];
 };
 
@@ -1,10 +1,48 @@
 #include <jni.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <android/log.h>
 #include "native_crash_handler.h"
+#include "crash_storage.h"
+#include "crash_package.h"
+#include "event_bus.h"
+#include "core/include/hprof_leak_trace.h"
 
 //需要动态注册native方法的 Java类名   当前native_crash_jni_bridge.cpp是所有JNI的代理类
 static const char *className = "com/github/andcrash/nativecrash/NativeCrash";
-static const char *callbackSignature = "(Ljava/lang/String;Ljava/lang/String;Lcom/github/andcrash/nativecrash/NativeCrashCallback;)V";
+static const char *eventBusClassName = "com/github/andcrash/nativecrash/NativeEventBus";
+
+static JavaVM *g_vm = nullptr;
+static jclass g_eventBusClass = nullptr;
+static jmethodID g_dispatchMethod = nullptr;
+static jobject g_eventBuffer = nullptr;
+// DirectByteBuffer背后的内存，每批事件拷贝到这里，Java侧直接读取
+static Event g_eventBatch[EventBus::kMaxBatch];
+// 与NativeEventBus中的EVENT_SIZE/DETAIL_OFFSET保持一致
+static_assert(sizeof(Event) == 280 && offsetof(Event, detail) == 24, "Event layout is shared with Java");
+
+/**
+ * EventBus分发线程上调用：一批事件只有一次JNI调用。
+ * 分发线程常驻不退出，首次调用attach后一直保持，不需要detach；
+ * 先GetEnv确认当前线程已attach，分发线程换了也不会用到别的线程的env
+ */
+static void JavaEventSink(const Event *events, size_t count) {
+    JNIEnv *env = nullptr;
+    if (g_vm->GetEnv((void **) &env, JNI_VERSION_1_6) != JNI_OK
+        && g_vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+        return;
+    }
+    if (!g_dispatchMethod) {
+        return;
+    }
+    memcpy(g_eventBatch, events, sizeof(Event) * count);
+    env->CallStaticVoidMethod(g_eventBusClass, g_dispatchMethod, g_eventBuffer, (jint) count);
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        env->ExceptionClear();
+    }
+}
 
 extern "C"
 JNIEXPORT void JNICALL
@@ -18,13 +56,11 @@ JNIEXPORT void JNICALL
 InitCrashHandler(JNIEnv *env,
                  jclass clazz,
                  jstring log_dir,
-                 jstring version,
-                 jobject callback) {
+                 jstring version) {
     const char *path = env->GetStringUTFChars(log_dir, nullptr);
     const char *ver = env->GetStringUTFChars(version, nullptr);
-    CrashHandler::Init(env, path, callback);
+    CrashHandler::Init(path);
     CrashHandler::SetVersion(ver);
-    CrashHandler::SetLogDir(path);
     env->ReleaseStringUTFChars(log_dir, path);
     env->ReleaseStringUTFChars(version, ver);
 }
@@ -47,14 +83,169 @@ DeleteCrashLogFile(JNIEnv *env, jclass clazz,
     return result;
 }
 
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+ListCrashLogs(JNIEnv *env, jclass clazz) {
+    std::vector<std::string> paths = CrashStorage::List();
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray result = env->NewObjectArray((jsize) paths.size(), stringClass, nullptr);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        jstring path = env->NewStringUTF(paths[i].c_str());
+        env->SetObjectArrayElement(result, (jsize) i, path);
+        env->DeleteLocalRef(path);
+    }
+    env->DeleteLocalRef(stringClass);
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+SetStorageQuota(JNIEnv *env, jclass clazz, jlong max_bytes, jint max_count) {
+    // 负数转成无符号后相当于取消配额
+    if (max_bytes <= 0 || max_count <= 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "AndCrash", "invalid storage quota: %lld bytes, %d logs",
+                            (long long) max_bytes, (int) max_count);
+        return;
+    }
+    CrashStorage::SetQuota((uint64_t) max_bytes, (uint32_t) max_count);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+DeleteAllCrashLogs(JNIEnv *env, jclass clazz) {
+    return CrashStorage::RemoveAll();
+}
+
+// 将引用链结果转换为String[]
+static jobjectArray ToJavaTraces(JNIEnv *env, const std::vector<LeakTrace> &traces) {
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray result = env->NewObjectArray((jsize) traces.size(), stringClass, nullptr);
+    for (size_t i = 0; i < traces.size(); ++i) {
+        jstring text = env->NewStringUTF(HprofLeakTrace::format(traces[i]).c_str());
+        env->SetObjectArrayElement(result, (jsize) i, text);
+        env->DeleteLocalRef(text);
+    }
+    env->DeleteLocalRef(stringClass);
+    return result;
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+FindLeakTracesByClass(JNIEnv *env, jclass clazz,
+                      jstring hprof_path,
+                      jstring class_name) {
+    const char *path = env->GetStringUTFChars(hprof_path, nullptr);
+    const char *name = env->GetStringUTFChars(class_name, nullptr);
+    HprofLeakTrace leakTrace;
+    std::vector<LeakTrace> traces;
+    if (leakTrace.open(path)) {
+        traces = leakTrace.findPathsByClass(name);
+    }
+    if (!traces.empty()) {
+        EventBus::Post(EventType::LeakDetected, (int64_t) traces.size(), name);
+    }
+    env->ReleaseStringUTFChars(hprof_path, path);
+    env->ReleaseStringUTFChars(class_name, name);
+    return ToJavaTraces(env, traces);
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+FindLeakTracesById(JNIEnv *env, jclass clazz,
+                   jstring hprof_path,
+                   jlongArray object_ids) {
+    const char *path = env->GetStringUTFChars(hprof_path, nullptr);
+    jsize count = env->GetArrayLength(object_ids);
+    std::vector<uint64_t> ids((size_t) count);
+    env->GetLongArrayRegion(object_ids, 0, count, reinterpret_cast<jlong *>(ids.data()));
+    HprofLeakTrace leakTrace;
+    std::vector<LeakTrace> traces;
+    if (leakTrace.open(path)) {
+        traces = leakTrace.findPaths(ids);
+    }
+    env->ReleaseStringUTFChars(hprof_path, path);
+    return ToJavaTraces(env, traces);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+PackCrashReports(JNIEnv *env, jclass clazz,
+                 jstring archive_path,
+                 jobjectArray paths,
+                 jint chunk_size,
+                 jbooleanArray packed) {
+    const char *archive = env->GetStringUTFChars(archive_path, nullptr);
+    jsize count = env->GetArrayLength(paths);
+    std::vector<std::string> files;
+    files.reserve((size_t) count);
+    for (jsize i = 0; i < count; ++i) {
+        auto path = (jstring) env->GetObjectArrayElement(paths, i);
+        const char *chars = env->GetStringUTFChars(path, nullptr);
+        files.emplace_back(chars);
+        env->ReleaseStringUTFChars(path, chars);
+        env->DeleteLocalRef(path);
+    }
+    std::vector<std::string> skipped;
+    int64_t size = CrashPackage::Pack(archive, files, (uint32_t) chunk_size, &skipped);
+    env->ReleaseStringUTFChars(archive_path, archive);
+    // packed[i]标记paths[i]是否真的进了压缩包
+    if (packed && env->GetArrayLength(packed) >= count) {
+        std::vector<jboolean> flags((size_t) count, size > 0 ? JNI_TRUE : JNI_FALSE);
+        for (jsize i = 0; i < count; ++i) {
+            if (std::find(skipped.begin(), skipped.end(), files[(size_t) i]) != skipped.end()) {
+                flags[(size_t) i] = JNI_FALSE;
+            }
+        }
+        env->SetBooleanArrayRegion(packed, 0, count, flags.data());
+    }
+    return (jlong) size;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+VerifyCrashPackage(JNIEnv *env, jclass clazz, jstring archive_path) {
+    const char *archive = env->GetStringUTFChars(archive_path, nullptr);
+    bool ok = CrashPackage::Extract(archive, std::string());
+    env->ReleaseStringUTFChars(archive_path, archive);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+PostEvent(JNIEnv *env, jclass clazz, jint type, jlong value, jstring detail) {
+    const char *chars = detail ? env->GetStringUTFChars(detail, nullptr) : nullptr;
+    bool posted = EventBus::Post(static_cast<EventType>(type), value, chars);
+    if (chars) {
+        env->ReleaseStringUTFChars(detail, chars);
+    }
+    return posted ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+DroppedEvents(JNIEnv *env, jclass clazz) {
+    return (jlong) EventBus::Dropped();
+}
+
 //需要动态注册的native方法数组
 static const JNINativeMethod methods[] = {{"testCrash",          "()V",                   (void *) testCrash},
-                                          {"initCrashHandler",   callbackSignature,       (void *) InitCrashHandler},
+                                          {"initCrashHandler",   "(Ljava/lang/String;Ljava/lang/String;)V", (void *) InitCrashHandler},
                                           {"SetVersion",         "(Ljava/lang/String;)V", (void *) SetVersion},
-                                          {"deleteCrashLogFile", "(Ljava/lang/String;)I", (void *) DeleteCrashLogFile}
+                                          {"deleteCrashLogFile", "(Ljava/lang/String;)I", (void *) DeleteCrashLogFile},
+                                          {"listCrashLogs",      "()[Ljava/lang/String;", (void *) ListCrashLogs},
+                                          {"SetStorageQuota",    "(JI)V",                 (void *) SetStorageQuota},
+                                          {"deleteAllCrashLogs", "()I",                   (void *) DeleteAllCrashLogs},
+                                          {"findLeakTracesByClass", "(Ljava/lang/String;Ljava/lang/String;)[Ljava/lang/String;", (void *) FindLeakTracesByClass},
+                                          {"findLeakTracesById", "(Ljava/lang/String;[J)[Ljava/lang/String;", (void *) FindLeakTracesById},
+                                          {"packCrashReports",   "(Ljava/lang/String;[Ljava/lang/String;I[Z)J", (void *) PackCrashReports},
+                                          {"verifyCrashPackage", "(Ljava/lang/String;)Z", (void *) VerifyCrashPackage}
 
 };
 
+static const JNINativeMethod eventBusMethods[] = {{"nativePost",    "(IJLjava/lang/String;)Z", (void *) PostEvent},
+                                                  {"nativeDropped", "()J",                     (void *) DroppedEvents}
+};
+
 
 //调用System.loadLibrary()函数时， 内部就会去查找so中的 JNI_OnLoad 函数，如果存在此函数则调用。
 jint JNI_OnLoad(JavaVM *vm, void *reserved) {
@@ -71,6 +262,16 @@ jint JNI_OnLoad(JavaVM *vm, void *reserved) {
     //注册Native   参数3：方法数量
     env->RegisterNatives(registerClass, methods, sizeof(methods) / sizeof(JNINativeMethod));
     env->DeleteLocalRef(registerClass);
+
+    // 分发线程由native创建，FindClass找不到应用类，这里提前缓存
+    g_vm = vm;
+    jclass eventBusClass = env->FindClass(eventBusClassName);
+    env->RegisterNatives(eventBusClass, eventBusMethods, sizeof(eventBusMethods) / sizeof(JNINativeMethod));
+    g_eventBusClass = (jclass) env->NewGlobalRef(eventBusClass);
+    g_dispatchMethod = env->GetStaticMethodID(eventBusClass, "dispatch", "(Ljava/nio/ByteBuffer;I)V");
+    g_eventBuffer = env->NewGlobalRef(env->NewDirectByteBuffer(g_eventBatch, sizeof(g_eventBatch)));
+    env->DeleteLocalRef(eventBusClass);
+    EventBus::SetSink(JavaEventSink);
     return JNI_VERSION_1_6;
 }
 
@@ -80,5 +281,9 @@ void JNI_OnUnload(JavaVM *vm, void *reserved) {
     if (r == JNI_OK) {
         jclass registerClass = env->FindClass(className);
         env->UnregisterNatives(registerClass);
+        EventBus::SetSink(nullptr);
+        if (g_eventBusClass) {
+            env->UnregisterNatives(g_eventBusClass);
+        }
     }
 }
\ No newline at end of file
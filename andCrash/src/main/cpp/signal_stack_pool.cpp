@@ -0,0 +1,179 @@
+#include "signal_stack_pool.h"
+#include "got_hook.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "core/include/log_utils.h"
+
+uintptr_t SignalStackPool::m_base = 0;
+size_t SignalStackPool::m_regionSize = 0;
+size_t SignalStackPool::m_pageSize = 0;
+size_t SignalStackPool::m_stackSize = 0;
+uint32_t SignalStackPool::m_maxStacks = 0;
+uint32_t SignalStackPool::m_highWater = 0;
+uint32_t *SignalStackPool::m_freeSlots = nullptr;
+uint32_t SignalStackPool::m_freeCount = 0;
+uint32_t SignalStackPool::m_inUse = 0;
+pthread_key_t SignalStackPool::m_key;
+pthread_mutex_t SignalStackPool::m_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef int (*PthreadCreate)(pthread_t *, const pthread_attr_t *, void *(*)(void *), void *);
+
+static PthreadCreate g_realPthreadCreate = nullptr;
+
+struct ThreadStart {
+    void *(*routine)(void *);
+    void *arg;
+};
+
+static void *ThreadTrampoline(void *p) {
+    ThreadStart start = *static_cast<ThreadStart *>(p);
+    free(p);
+    SignalStackPool::AttachCurrentThread();
+    return start.routine(start.arg);
+}
+
+static int PthreadCreateProxy(pthread_t *thread, const pthread_attr_t *attr,
+                              void *(*routine)(void *), void *arg) {
+    auto *start = static_cast<ThreadStart *>(malloc(sizeof(ThreadStart)));
+    if (!start) {
+        return g_realPthreadCreate(thread, attr, routine, arg);
+    }
+    start->routine = routine;
+    start->arg = arg;
+    int ret = g_realPthreadCreate(thread, attr, ThreadTrampoline, start);
+    if (ret != 0) {
+        free(start);
+    }
+    return ret;
+}
+
+bool SignalStackPool::Init(size_t stackSize, uint32_t maxStacks) {
+    pthread_mutex_lock(&m_mutex);
+    if (m_base) {
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+    m_pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    m_stackSize = (stackSize + m_pageSize - 1) & ~(m_pageSize - 1);
+    // 每个槽位：低地址一页保护页 + 栈（栈向下生长，溢出落到本槽位的保护页）
+    m_regionSize = (m_pageSize + m_stackSize) * maxStacks;
+    void *region = mmap(nullptr, m_regionSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    void *slots = mmap(nullptr, sizeof(uint32_t) * maxStacks, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED || slots == MAP_FAILED || pthread_key_create(&m_key, OnThreadExit) != 0) {
+        if (region != MAP_FAILED) munmap(region, m_regionSize);
+        if (slots != MAP_FAILED) munmap(slots, sizeof(uint32_t) * maxStacks);
+        pthread_mutex_unlock(&m_mutex);
+        log_utils::error("AndCrash", "SignalStackPool reserve failed");
+        return false;
+    }
+    m_freeSlots = static_cast<uint32_t *>(slots);
+    m_maxStacks = maxStacks;
+    m_base = reinterpret_cast<uintptr_t>(region);
+    pthread_mutex_unlock(&m_mutex);
+    return true;
+}
+
+void *SignalStackPool::Acquire() {
+    pthread_mutex_lock(&m_mutex);
+    uintptr_t stack = 0;
+    if (m_freeCount > 0) {
+        stack = m_base + m_freeSlots[--m_freeCount] * (m_pageSize + m_stackSize) + m_pageSize;
+    } else if (m_highWater < m_maxStacks) {
+        uintptr_t candidate = m_base + m_highWater * (m_pageSize + m_stackSize) + m_pageSize;
+        if (mprotect(reinterpret_cast<void *>(candidate), m_stackSize, PROT_READ | PROT_WRITE) == 0) {
+            stack = candidate;
+            m_highWater++;
+        }
+    }
+    if (stack) {
+        m_inUse++;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    if (stack) {
+        return reinterpret_cast<void *>(stack);
+    }
+
+    // 池用尽：单独映射，同样留一页保护页
+    void *mapping = mmap(nullptr, m_pageSize + m_stackSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    void *top = static_cast<char *>(mapping) + m_pageSize;
+    if (mprotect(top, m_stackSize, PROT_READ | PROT_WRITE) != 0) {
+        munmap(mapping, m_pageSize + m_stackSize);
+        return nullptr;
+    }
+    return top;
+}
+
+void SignalStackPool::Release(void *stack) {
+    auto addr = reinterpret_cast<uintptr_t>(stack);
+    if (addr < m_base || addr >= m_base + m_regionSize) {
+        munmap(static_cast<char *>(stack) - m_pageSize, m_pageSize + m_stackSize);
+        return;
+    }
+    pthread_mutex_lock(&m_mutex);
+    m_freeSlots[m_freeCount++] = (uint32_t) ((addr - m_base) / (m_pageSize + m_stackSize));
+    m_inUse--;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool SignalStackPool::AttachCurrentThread() {
+    if (!m_base || pthread_getspecific(m_key)) {
+        return m_base != 0;
+    }
+    stack_t old{};
+    if (sigaltstack(nullptr, &old) == 0 && !(old.ss_flags & SS_DISABLE) && old.ss_size >= m_stackSize) {
+        return true;
+    }
+    void *stack = Acquire();
+    if (!stack) {
+        return false;
+    }
+    stack_t ss{};
+    ss.ss_sp = stack;
+    ss.ss_size = m_stackSize;
+    ss.ss_flags = 0;
+    if (sigaltstack(&ss, nullptr) != 0) {
+        Release(stack);
+        return false;
+    }
+    pthread_setspecific(m_key, stack);
+    return true;
+}
+
+void SignalStackPool::OnThreadExit(void *stack) {
+    stack_t current{};
+    // 只有仍在使用我们的栈时才关闭，其他组件后来替换的备用栈不动
+    if (sigaltstack(nullptr, &current) == 0 && current.ss_sp == stack) {
+        if (current.ss_flags & SS_ONSTACK) {
+            return;  // 正在信号处理函数中退出，栈不能复用
+        }
+        stack_t disable{};
+        disable.ss_flags = SS_DISABLE;
+        sigaltstack(&disable, nullptr);
+    }
+    Release(stack);
+}
+
+uint32_t SignalStackPool::InUse() {
+    pthread_mutex_lock(&m_mutex);
+    uint32_t inUse = m_inUse;
+    pthread_mutex_unlock(&m_mutex);
+    return inUse;
+}
+
+int SignalStackPool::HookPthreadCreate() {
+    if (!g_realPthreadCreate) {
+        g_realPthreadCreate = reinterpret_cast<PthreadCreate>(dlsym(RTLD_DEFAULT, "pthread_create"));
+        if (!g_realPthreadCreate) {
+            return 0;
+        }
+    }
+    return GotHook::Replace("pthread_create", reinterpret_cast<void *>(PthreadCreateProxy), nullptr);
+}
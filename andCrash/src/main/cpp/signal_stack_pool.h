@@ -0,0 +1,59 @@
+#ifndef ANDROID_SIGNAL_STACK_POOL_H
+#define ANDROID_SIGNAL_STACK_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <pthread.h>
+
+/**
+ * 线程备用信号栈池
+ *
+ * 启动时只预留一整块地址空间（PROT_NONE，不占物理内存），布局为 [guard][stack][guard][stack]...，
+ * 槽位第一次被使用时才mprotect为可读写；线程退出时（pthread_key析构）归还槽位供后续线程复用。
+ * 通过PLT hook替换已加载so中的pthread_create，新线程在执行入口函数前先挂上备用栈，
+ * 任意线程栈溢出时信号处理函数都有栈可用。池用尽时退化为单独mmap（同样带保护页）。
+ */
+class SignalStackPool final {
+public:
+    // SIGSTKSZ（8K）不够栈回溯+dladdr使用
+    static constexpr size_t kDefaultStackSize = 64 * 1024;
+    static constexpr uint32_t kDefaultMaxStacks = 256;
+
+    // 预留地址空间，重复调用无效
+    static bool Init(size_t stackSize = kDefaultStackSize, uint32_t maxStacks = kDefaultMaxStacks);
+
+    // 为当前线程挂上备用栈；已有不小于stackSize的备用栈（例如ART线程）则保留原来的
+    static bool AttachCurrentThread();
+
+    // 替换已加载so的pthread_create GOT项，返回替换数量（之后加载的so不受影响）
+    static int HookPthreadCreate();
+
+    // 正在被线程占用的池内槽位数
+    static uint32_t InUse();
+
+    SignalStackPool(const SignalStackPool &) = delete;
+
+    void operator=(const SignalStackPool &) = delete;
+
+private:
+    static void *Acquire();
+
+    static void Release(void *stack);
+
+    // pthread_key析构：线程退出时关闭备用栈并归还
+    static void OnThreadExit(void *stack);
+
+    static uintptr_t m_base;
+    static size_t m_regionSize;
+    static size_t m_pageSize;
+    static size_t m_stackSize;
+    static uint32_t m_maxStacks;
+    static uint32_t m_highWater;     // 已提交（可读写）过的槽位数
+    static uint32_t *m_freeSlots;    // 已归还槽位，后进先出，优先复用仍在缓存中的栈
+    static uint32_t m_freeCount;
+    static uint32_t m_inUse;
+    static pthread_key_t m_key;
+    static pthread_mutex_t m_mutex;
+};
+
+#endif //ANDROID_SIGNAL_STACK_POOL_H
@@ -15,6 +15,8 @@ import org.jetbrains.annotations.NotNull;
 
 import java.io.File;
 import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.List;
 import java.util.concurrent.CopyOnWriteArrayList;
 import java.util.concurrent.ExecutorService;
@@ -27,6 +29,10 @@ public final class AndCrash implements Thread.UncaughtExceptionHandler {
     private Context context;
     private LogUploader uploader;
     private long retentionDays = 7;
+    // crash_batches目录上限：上传一直失败时压缩包不能无限累积
+    private long maxBatchBytes = 20L * 1024 * 1024;
+    // 打包中的.acpk.tmp超过这个时间还没改名，说明打包时进程被杀了
+    private static final long STALE_TMP_MS = 10 * 60 * 1000L;
     private ExecutorService executor = Executors.newSingleThreadExecutor();
     private Thread.UncaughtExceptionHandler defaultHandler;
     private String logDir;
@@ -68,6 +74,14 @@ public final class AndCrash implements Thread.UncaughtExceptionHandler {
         return this;
     }
 
+    /**
+     * 待续传压缩包（crash_batches）的总大小上限，超出时从最旧的开始删除；过期时间与日志相同
+     */
+    public AndCrash setMaxBatchBytes(long maxBytes) {
+        this.maxBatchBytes = maxBytes;
+        return this;
+    }
+
     public AndCrash setLogDir(String logDir) {
         this.logDir = logDir;
         return this;
@@ -159,22 +173,29 @@ public final class AndCrash implements Thread.UncaughtExceptionHandler {
     //上传未上传的日志
     public void uploadPendingLogs() {
         if (uploader == null || TextUtils.isEmpty(this.logDir)) return;
+        uploadBatches(new File(context.getFilesDir(), "crash_batches"));
         File[] logs = getLogOrCreateDirectory().listFiles((dir, name) -> name.endsWith(".log"));
         if (logs != null && logs.length > 0) {
-            uploadPendingLogs(logs);
+            uploadPendingLogs(logs, false);
             return;
         }
         Log.d(TAG, "uploadPendingLogs log file is null");
     }
 
-    private void uploadPendingLogs(File[] logs) {
+    /**
+     * @param nativeReports crash_dumps下的native崩溃报告，删除时需同步更新native侧的manifest
+     */
+    private void uploadPendingLogs(File[] logs, boolean nativeReports) {
+        if (logs.length > 1 && uploadPackage(logs, nativeReports)) {
+            return;
+        }
         for (File log : logs) {
             Log.d(TAG, "Upload pending log: " + log.getName());
             uploader.upload(log, new UploadCallback() {
                 @Override
                 public void onSuccess(File file) {
                     if (file.exists()) {
-                        boolean deleteResult = file.delete();
+                        boolean deleteResult = deleteLog(file, nativeReports);
                         Log.d(TAG, "Delete result: " + deleteResult + " name: " + file.getName());
                     }
                 }
@@ -188,6 +209,110 @@ public final class AndCrash implements Thread.UncaughtExceptionHandler {
     }
 
 
+    /**
+     * 多个日志打成一个分块压缩包，一次请求上传；打包成功后已打进包的原日志即删除，
+     * 上传失败的压缩包保留在crash_batches目录，下次启动优先续传。打包失败时退回逐个上传
+     */
+    private boolean uploadPackage(File[] logs, boolean nativeReports) {
+        File batchDir = new File(context.getFilesDir(), "crash_batches");
+        if (!batchDir.exists() && !batchDir.mkdirs()) {
+            return false;
+        }
+        String[] paths = new String[logs.length];
+        for (int i = 0; i < logs.length; i++) {
+            paths[i] = logs[i].getAbsolutePath();
+        }
+        File archive;
+        try {
+            // Java日志和native报告可能在同一毫秒打包，文件名不能只靠时间戳
+            archive = File.createTempFile(nativeReports ? "native-batch-" : "crash-batch-", ".acpk", batchDir);
+        } catch (IOException e) {
+            return false;
+        }
+        boolean[] packed = new boolean[logs.length];
+        if (NativeCrash.packReports(archive.getAbsolutePath(), paths, packed) <= 0) {
+            archive.delete();
+            return false;
+        }
+        List<File> skipped = new ArrayList<>();
+        for (int i = 0; i < logs.length; i++) {
+            if (!packed[i]) {
+                // 没打进压缩包的日志保留，逐个上传
+                skipped.add(logs[i]);
+                continue;
+            }
+            boolean deleteResult = deleteLog(logs[i], nativeReports);
+            Log.d(TAG, "Packed and delete result: " + deleteResult + " name: " + logs[i].getName());
+        }
+        if (skipped.size() == logs.length) {
+            archive.delete();
+            return false;
+        }
+        uploadBatch(archive);
+        if (!skipped.isEmpty()) {
+            Log.w(TAG, skipped.size() + " logs not packed, upload separately");
+            uploadPendingLogs(skipped.toArray(new File[0]), nativeReports);
+        }
+        return true;
+    }
+
+    private static boolean deleteLog(File log, boolean nativeReport) {
+        return nativeReport ? NativeCrash.deleteFile(log.getAbsolutePath()) == 0 : log.delete();
+    }
+
+    private void uploadBatches(File batchDir) {
+        File[] batches = batchDir.listFiles((dir, name) -> name.endsWith(".acpk") || name.endsWith(".acpk.tmp"));
+        if (batches == null) return;
+        for (File batch : cleanBatches(batches)) {
+            uploadBatch(batch);
+        }
+    }
+
+    /**
+     * 删除打包中断留下的临时文件和过期的压缩包，再按总大小上限（临时文件也计入）从最旧的开始删除
+     * @return 剩余可上传的压缩包，旧的在前
+     */
+    private List<File> cleanBatches(File[] batches) {
+        Arrays.sort(batches, (a, b) -> Long.compare(a.lastModified(), b.lastModified()));
+        long now = System.currentTimeMillis();
+        long cutoff = now - (retentionDays * 86400000L);
+        long total = 0;
+        for (File batch : batches) {
+            total += batch.length();
+        }
+        List<File> kept = new ArrayList<>();
+        for (File batch : batches) {
+            boolean tmp = batch.getName().endsWith(".tmp");
+            // 空文件是打包前进程就退出留下的；最近的临时文件可能正在打包
+            boolean stale = tmp ? batch.lastModified() < now - STALE_TMP_MS : batch.length() == 0;
+            if (stale || batch.lastModified() < cutoff || total > maxBatchBytes) {
+                total -= batch.length();
+                boolean deleteResult = batch.delete();
+                Log.w(TAG, "Delete stale crash batch delete result: " + deleteResult + " name: " + batch.getName());
+            } else if (!tmp) {
+                kept.add(batch);
+            }
+        }
+        return kept;
+    }
+
+    private void uploadBatch(File batch) {
+        Log.d(TAG, "Upload crash batch: " + batch.getName());
+        uploader.upload(batch, new UploadCallback() {
+            @Override
+            public void onSuccess(File file) {
+                boolean deleteResult = file.delete();
+                Log.d(TAG, "Delete result: " + deleteResult + " name: " + file.getName());
+            }
+
+            @Override
+            public void onFailure(File file, Exception e) {
+                Log.w(TAG, "Upload failed, keep for resume: " + file.getName());
+            }
+        });
+    }
+
+
     private File getLogOrCreateDirectory() {
         if (this.logDir != null) return new File(this.logDir);
         File externalDir = context.getFilesDir();
@@ -200,7 +325,24 @@ public final class AndCrash implements Thread.UncaughtExceptionHandler {
     }
 
 
+    /**
+     * 设置了uploader时，上次遗留的native崩溃报告与Java日志一样打包上传，不再回调callback.onCrashUpload
+     */
     public void initNativeCrash(Context context, String version, NativeCrashCallback callback) {
-        NativeCrash.initCrash(context, version, callback);
+        NativeCrash.initCrash(context, version, new NativeCrashCallback() {
+            @Override
+            public void onCrashReport(@NonNull String crashLogPath) {
+                callback.onCrashReport(crashLogPath);
+            }
+
+            @Override
+            public void onCrashUpload(@NonNull File[] crashLogPath) {
+                if (uploader == null) {
+                    callback.onCrashUpload(crashLogPath);
+                    return;
+                }
+                executor.execute(() -> uploadPendingLogs(crashLogPath, true));
+            }
+        });
     }
 }
\ No newline at end of file
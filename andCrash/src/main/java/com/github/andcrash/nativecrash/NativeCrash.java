@@ -10,23 +10,59 @@ public class NativeCrash {
         System.loadLibrary("nativeCrash");
     }
 
+    private static NativeEventListener crashListener;
+
 
     public static void initCrash(Context context,
                                  String version,
                                  NativeCrashCallback callback) {
-        initCrashHandler(getCrashLogDirectory(context), version, callback);
-        File crashLogDirectory = new File(getCrashLogDirectory(context));
-        if (!crashLogDirectory.exists()) {
-            return;
+        // 崩溃事件带实际报告路径，从事件总线转给callback；重复init时替换之前的callback
+        synchronized (NativeCrash.class) {
+            if (crashListener != null) {
+                NativeEventBus.removeListener(crashListener);
+            }
+            crashListener = events -> {
+                for (NativeEvent event : events) {
+                    if (event.type == NativeEventBus.TYPE_CRASH) {
+                        callback.onCrashReport(event.detail);
+                    }
+                }
+            };
+            NativeEventBus.addListener(crashListener);
         }
-        File[] files = crashLogDirectory.listFiles();
-        if (files == null || files.length == 0) {
-            return;
+        initCrashHandler(getCrashLogDirectory(context), version);
+        // manifest在native后台线程加载，listCrashLogs会等待加载完成，不放在调用线程
+        new Thread(() -> {
+            String[] paths = listCrashLogs();
+            if (paths == null || paths.length == 0) {
+                return;
+            }
+            File[] files = new File[paths.length];
+            for (int i = 0; i < paths.length; i++) {
+                files[i] = new File(paths[i]);
+            }
+            callback.onCrashUpload(files);
+        }, "AndCrash-pending").start();
+    }
+
+    private static native void initCrashHandler(String logDir, String version);
+
+    private static native String[] listCrashLogs();
+
+
+    /**
+     * 设置崩溃日志目录配额，超出后从最旧的日志开始淘汰
+     * @param maxBytes 日志总大小上限，必须大于0
+     * @param maxCount 日志数量上限，必须大于0
+     */
+    public static void setStorageQuota(long maxBytes, int maxCount) {
+        if (maxBytes <= 0 || maxCount <= 0) {
+            throw new IllegalArgumentException("invalid storage quota: " + maxBytes + " bytes, " + maxCount + " logs");
         }
-        callback.onCrashUpload(files);
+        SetStorageQuota(maxBytes, maxCount);
     }
 
-    private static native void initCrashHandler(String logDir, String version, NativeCrashCallback callback);
+    private static native void SetStorageQuota(long maxBytes, int maxCount);
 
 
     public static void setVersion(String version) {
@@ -60,4 +96,57 @@ public class NativeCrash {
     }
 
     private static native int deleteCrashLogFile(String logPath);
-}
\ No newline at end of file
+
+    public static int deleteAllFiles() {
+        return deleteAllCrashLogs();
+    }
+
+    private static native int deleteAllCrashLogs();
+
+    /**
+     * 查询某个类（例如泄漏的Activity）所有实例到GC Root的最短引用链
+     * 耗时操作，不要在主线程调用
+     * @return 每个实例一条格式化后的引用链
+     */
+    public static String[] findLeakTraces(String hprofPath, String className) {
+        return findLeakTracesByClass(hprofPath, className);
+    }
+
+    /**
+     * 批量查询对象到GC Root的最短引用链，一次遍历完成
+     */
+    public static String[] findLeakTraces(String hprofPath, long[] objectIds) {
+        return findLeakTracesById(hprofPath, objectIds);
+    }
+
+    private static native String[] findLeakTracesByClass(String hprofPath, String className);
+
+    private static native String[] findLeakTracesById(String hprofPath, long[] objectIds);
+
+    /**
+     * 把多个崩溃日志/面包屑/hprof片段打成一个分块压缩包（带索引、逐块crc32，可按块偏移续传），便于一次请求上传
+     * 耗时操作，不要在主线程调用
+     * @return 压缩包大小，失败返回-1
+     */
+    public static long packReports(String archivePath, String[] paths) {
+        return packCrashReports(archivePath, paths, 0, null);
+    }
+
+    /**
+     * 同上，packed[i]返回paths[i]是否真的打进了压缩包（无法读取的文件会被跳过，不能当作已上传删除）
+     */
+    public static long packReports(String archivePath, String[] paths, boolean[] packed) {
+        return packCrashReports(archivePath, paths, 0, packed);
+    }
+
+    /**
+     * 逐块校验压缩包
+     */
+    public static boolean verifyPackage(String archivePath) {
+        return verifyCrashPackage(archivePath);
+    }
+
+    private static native long packCrashReports(String archivePath, String[] paths, int chunkSize, boolean[] packed);
+
+    private static native boolean verifyCrashPackage(String archivePath);
+}
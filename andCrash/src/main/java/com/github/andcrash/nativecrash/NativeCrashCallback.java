@@ -5,7 +5,9 @@ import androidx.annotation.NonNull;
 import java.io.File;
 
 public interface NativeCrashCallback {
+    // 在native事件分发线程回调，crashLogPath为本次崩溃报告的完整路径
     void onCrashReport(@NonNull String crashLogPath);
 
+    // 在后台线程回调；经AndCrash.initNativeCrash初始化且设置了uploader时由AndCrash打包上传，不回调
     void onCrashUpload(@NonNull File[] crashLogPath);
 }
\ No newline at end of file
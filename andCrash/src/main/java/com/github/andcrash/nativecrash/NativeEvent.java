@@ -0,0 +1,36 @@
+package com.github.andcrash.nativecrash;
+
+import androidx.annotation.NonNull;
+
+/**
+ * native事件总线投递的一条事件
+ */
+public final class NativeEvent {
+    public final int type;
+    public final int tid;
+    public final long timeMillis;
+    /**
+     * 崩溃：信号；内存阈值：字节数；泄漏：实例数
+     */
+    public final long value;
+    /**
+     * 崩溃：报告路径；泄漏：类名
+     */
+    @NonNull
+    public final String detail;
+
+    NativeEvent(int type, int tid, long timeMillis, long value, @NonNull String detail) {
+        this.type = type;
+        this.tid = tid;
+        this.timeMillis = timeMillis;
+        this.value = value;
+        this.detail = detail;
+    }
+
+    @NonNull
+    @Override
+    public String toString() {
+        return "NativeEvent{type=" + type + ", tid=" + tid + ", time=" + timeMillis
+                + ", value=" + value + ", detail=" + detail + "}";
+    }
+}
@@ -0,0 +1,110 @@
+package com.github.andcrash.nativecrash;
+
+import androidx.annotation.Keep;
+import androidx.annotation.NonNull;
+import androidx.annotation.Nullable;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+import java.util.concurrent.CopyOnWriteArrayList;
+
+/**
+ * native -> Java 事件总线（crash/ANR/内存阈值/泄漏）
+ * native侧是定长无锁队列，任意线程和信号处理函数中都能投递；单个分发线程攒批后一次JNI调用交给这里
+ */
+@Keep
+public final class NativeEventBus {
+    public static final int TYPE_CRASH = 1;
+    public static final int TYPE_ANR = 2;
+    public static final int TYPE_MEMORY_THRESHOLD = 3;
+    public static final int TYPE_LEAK_DETECTED = 4;
+
+    // 与native Event结构体布局一致
+    private static final int EVENT_SIZE = 280;
+    private static final int DETAIL_OFFSET = 24;
+    private static final int DETAIL_SIZE = 256;
+    // 还没有监听者时暂存的事件上限
+    private static final int MAX_PENDING = 64;
+
+    private static final List<NativeEventListener> listeners = new CopyOnWriteArrayList<>();
+    private static final List<NativeEvent> pending = new ArrayList<>();
+
+    static {
+        System.loadLibrary("nativeCrash");
+    }
+
+    private NativeEventBus() {
+    }
+
+    /**
+     * 注册监听；注册前已经到达的事件（最多64条）会先投递给第一个监听者
+     */
+    public static void addListener(@NonNull NativeEventListener listener) {
+        List<NativeEvent> replay;
+        synchronized (pending) {
+            listeners.add(listener);
+            replay = new ArrayList<>(pending);
+            pending.clear();
+        }
+        if (!replay.isEmpty()) {
+            listener.onEvents(Collections.unmodifiableList(replay));
+        }
+    }
+
+    public static void removeListener(@NonNull NativeEventListener listener) {
+        listeners.remove(listener);
+    }
+
+    /**
+     * Java侧监控（例如ANR watchdog）投递事件，与native事件走同一条分发线程
+     * @return 队列满时返回false
+     */
+    public static boolean post(int type, long value, @Nullable String detail) {
+        return nativePost(type, value, detail);
+    }
+
+    /**
+     * 因队列满被丢弃的事件数
+     */
+    public static long droppedCount() {
+        return nativeDropped();
+    }
+
+    // native分发线程调用，每批一次
+    private static void dispatch(ByteBuffer buffer, int count) {
+        buffer.order(ByteOrder.nativeOrder());
+        List<NativeEvent> events = new ArrayList<>(count);
+        byte[] detail = new byte[DETAIL_SIZE];
+        for (int i = 0; i < count; i++) {
+            int base = i * EVENT_SIZE;
+            int length = 0;
+            for (; length < DETAIL_SIZE - 1 && buffer.get(base + DETAIL_OFFSET + length) != 0; length++) {
+                detail[length] = buffer.get(base + DETAIL_OFFSET + length);
+            }
+            events.add(new NativeEvent(buffer.getInt(base), buffer.getInt(base + 4), buffer.getLong(base + 8),
+                    buffer.getLong(base + 16), new String(detail, 0, length, StandardCharsets.UTF_8)));
+        }
+        List<NativeEvent> batch = Collections.unmodifiableList(events);
+        synchronized (pending) {
+            if (listeners.isEmpty()) {
+                for (NativeEvent event : events) {
+                    if (pending.size() < MAX_PENDING) {
+                        pending.add(event);
+                    }
+                }
+                return;
+            }
+        }
+        for (NativeEventListener listener : listeners) {
+            listener.onEvents(batch);
+        }
+    }
+
+    private static native boolean nativePost(int type, long value, String detail);
+
+    private static native long nativeDropped();
+}
@@ -0,0 +1,10 @@
+package com.github.andcrash.nativecrash;
+
+import androidx.annotation.NonNull;
+
+import java.util.List;
+
+public interface NativeEventListener {
+    // 在native分发线程上按批回调，不要做耗时操作
+    void onEvents(@NonNull List<NativeEvent> events);
+}
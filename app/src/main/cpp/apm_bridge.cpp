@@ -1,5 +1,6 @@
 #include <jni.h>
 #include "and_apm.h"
+#include "guarded_allocator.h"
 
 //这个文件相当于中介，介于C/C++和Java之间进行通信
 
@@ -23,10 +24,16 @@ destroy(JNIEnv *env, jobject thiz, jlong ptr) {
     reinterpret_cast<apm::AndApm *>(ptr)->destroy(static_cast<long>(ptr));
 }
 
+JNIEXPORT jboolean JNICALL
+enableGuardedAllocator(JNIEnv *env, jclass thiz, jint sampleRate, jint slots) {
+    return apm::GuardedAllocator::Enable(static_cast<uint32_t>(sampleRate), static_cast<uint32_t>(slots));
+}
+
 static const JNINativeMethod methods[] = {{"nativeStart",   "(J)V", (void *) start},
                                           {"nativeStop",    "(J)V", (void *) stop},
                                           {"nativeInit",    "()J",  (void *) init},
-                                          {"nativeDestroy", "(J)V", (void *) destroy}};
+                                          {"nativeDestroy", "(J)V", (void *) destroy},
+                                          {"nativeEnableGuardedAllocator", "(II)Z", (void *) enableGuardedAllocator}};
 
 jint JNI_OnLoad(JavaVM *vm, void *reserved) {
     JNIEnv *env = JNI_OK;
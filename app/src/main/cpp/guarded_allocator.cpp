@@ -0,0 +1,613 @@
+#include <android/log.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dlfcn.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <unwind.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "guarded_allocator.h"
+
+extern "C" {
+void *apm_malloc(size_t size);
+void *apm_calloc(size_t count, size_t size);
+void *apm_realloc(void *ptr, size_t size);
+void apm_free(void *ptr);
+}
+
+namespace apm {
+
+    uintptr_t GuardedAllocator::m_poolStart = 0;
+    uintptr_t GuardedAllocator::m_poolEnd = 0;
+    size_t GuardedAllocator::m_pageSize = 0;
+    uint32_t GuardedAllocator::m_slots = 0;
+    uint32_t GuardedAllocator::m_sampleRate = GuardedAllocator::kDefaultSampleRate;
+    GuardedAllocator::SlotMeta *GuardedAllocator::m_meta = nullptr;
+    uint32_t *GuardedAllocator::m_freeSlots = nullptr;
+    uint32_t GuardedAllocator::m_freeHead = 0;
+    uint32_t GuardedAllocator::m_freeCount = 0;
+    std::atomic_flag GuardedAllocator::m_lock = ATOMIC_FLAG_INIT;
+    pthread_key_t GuardedAllocator::m_counterKey;
+    pthread_key_t GuardedAllocator::m_randomKey;
+    const char *GuardedAllocator::m_libraryFilter = GuardedAllocator::kAppLibraries;
+    GuardedAllocator::MallocFn GuardedAllocator::m_realMalloc = nullptr;
+    GuardedAllocator::CallocFn GuardedAllocator::m_realCalloc = nullptr;
+    GuardedAllocator::ReallocFn GuardedAllocator::m_realRealloc = nullptr;
+    GuardedAllocator::FreeFn GuardedAllocator::m_realFree = nullptr;
+    GuardedAllocator::MemalignFn GuardedAllocator::m_realMemalign = nullptr;
+    GuardedAllocator::UsableSizeFn GuardedAllocator::m_realUsableSize = nullptr;
+    GuardedAllocator::GetdelimFn GuardedAllocator::m_realGetdelim = nullptr;
+    GuardedAllocator::DlopenFn GuardedAllocator::m_realDlopen = nullptr;
+    GuardedAllocator::DlopenExtFn GuardedAllocator::m_realDlopenExt = nullptr;
+    GuardedAllocator::LoaderDlopenFn GuardedAllocator::m_loaderDlopen = nullptr;
+    GuardedAllocator::LoaderDlopenExtFn GuardedAllocator::m_loaderDlopenExt = nullptr;
+    void *GuardedAllocator::m_replaceGot = nullptr;
+    pthread_mutex_t GuardedAllocator::m_hookLock = PTHREAD_MUTEX_INITIALIZER;
+    std::atomic_bool GuardedAllocator::m_enabled(false);
+    std::atomic<uint32_t> GuardedAllocator::m_errorType(0);
+    size_t GuardedAllocator::m_errorSlot = 0;
+    uintptr_t GuardedAllocator::m_errorAddr = 0;
+
+    // nativeCrash导出的函数：
+    //  void and_crash_register_fault_describer(bool (*)(void *, int))
+    //  int and_crash_replace_got(const char *symbol, void *replacement, bool (*filter)(const char *path))
+    typedef void (*RegisterDescriber)(bool (*)(void *, int));
+    typedef int (*ReplaceGot)(const char *, void *, bool (*)(const char *));
+
+    static void *FindNativeCrashSymbol(const char *name) {
+        void *symbol = dlsym(RTLD_DEFAULT, name);
+        if (!symbol) {
+            void *handle = dlopen("libnativeCrash.so", RTLD_NOW | RTLD_NOLOAD);
+            symbol = handle ? dlsym(handle, name) : nullptr;
+        }
+        return symbol;
+    }
+
+    static const char *BaseName(const char *path) {
+        const char *slash = strrchr(path, '/');
+        return slash ? slash + 1 : path;
+    }
+
+    // xorshift，采样间隔在[1, 2 * sampleRate)内均匀分布，平均每sampleRate次采样一次
+    uint32_t GuardedAllocator::NextRandom() {
+        auto state = (uint32_t) (uintptr_t) pthread_getspecific(m_randomKey);
+        if (state == 0) {
+            state = (((uint32_t) syscall(SYS_gettid) * 2654435761u) ^ (uint32_t) time(nullptr)) | 1u;
+        }
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        pthread_setspecific(m_randomKey, reinterpret_cast<void *>((uintptr_t) state));
+        return state;
+    }
+
+    struct BacktraceState {
+        uintptr_t *current;
+        uintptr_t *end;
+    };
+
+    static _Unwind_Reason_Code UnwindCallback(struct _Unwind_Context *ctx, void *arg) {
+        auto *state = static_cast<BacktraceState *>(arg);
+        uintptr_t pc = _Unwind_GetIP(ctx);
+        if (pc && state->current < state->end) {
+            *state->current++ = pc;
+        }
+        return state->current < state->end ? _URC_NO_REASON : _URC_END_OF_STACK;
+    }
+
+    bool GuardedAllocator::Enable(uint32_t sampleRate, uint32_t slots, const char *libraryFilter) {
+        if (m_enabled.load() || sampleRate == 0 || slots == 0 || !libraryFilter) {
+            return false;
+        }
+        // 没有GOT hook就没有分配会进入保护池
+        void *replaceGot = FindNativeCrashSymbol("and_crash_replace_got");
+        if (!replaceGot) {
+            __android_log_print(ANDROID_LOG_ERROR, "AndCrash", "nativeCrash not loaded, guarded allocator disabled");
+            return false;
+        }
+        // hook之后本库里的malloc等也可能被替换，兜底统一走libc的实现
+        m_realMalloc = reinterpret_cast<MallocFn>(dlsym(RTLD_DEFAULT, "malloc"));
+        m_realCalloc = reinterpret_cast<CallocFn>(dlsym(RTLD_DEFAULT, "calloc"));
+        m_realRealloc = reinterpret_cast<ReallocFn>(dlsym(RTLD_DEFAULT, "realloc"));
+        m_realFree = reinterpret_cast<FreeFn>(dlsym(RTLD_DEFAULT, "free"));
+        m_realMemalign = reinterpret_cast<MemalignFn>(dlsym(RTLD_DEFAULT, "memalign"));
+        m_realUsableSize = reinterpret_cast<UsableSizeFn>(dlsym(RTLD_DEFAULT, "malloc_usable_size"));
+        m_realGetdelim = reinterpret_cast<GetdelimFn>(dlsym(RTLD_DEFAULT, "getdelim"));
+        if (!m_realMalloc || !m_realCalloc || !m_realRealloc || !m_realFree || !m_realMemalign
+            || !m_realUsableSize || !m_realGetdelim) {
+            return false;
+        }
+        m_realDlopen = reinterpret_cast<DlopenFn>(dlsym(RTLD_DEFAULT, "dlopen"));
+        m_realDlopenExt = reinterpret_cast<DlopenExtFn>(dlsym(RTLD_DEFAULT, "android_dlopen_ext"));
+        m_loaderDlopen = reinterpret_cast<LoaderDlopenFn>(dlsym(RTLD_DEFAULT, "__loader_dlopen"));
+        m_loaderDlopenExt = reinterpret_cast<LoaderDlopenExtFn>(dlsym(RTLD_DEFAULT, "__loader_android_dlopen_ext"));
+        if (pthread_key_create(&m_counterKey, nullptr) != 0) {
+            return false;
+        }
+        if (pthread_key_create(&m_randomKey, nullptr) != 0) {
+            pthread_key_delete(m_counterKey);
+            return false;
+        }
+        m_pageSize = (size_t) sysconf(_SC_PAGESIZE);
+        // [guard][slot0][guard][slot1]...[guard]
+        size_t poolSize = m_pageSize * (2 * (size_t) slots + 1);
+        void *pool = mmap(nullptr, poolSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (pool == MAP_FAILED) {
+            pthread_key_delete(m_counterKey);
+            pthread_key_delete(m_randomKey);
+            return false;
+        }
+        // 元数据不走malloc，避免和被监控的堆互相影响
+        size_t metaSize = sizeof(SlotMeta) * slots + sizeof(uint32_t) * slots;
+        void *meta = mmap(nullptr, metaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (meta == MAP_FAILED) {
+            munmap(pool, poolSize);
+            pthread_key_delete(m_counterKey);
+            pthread_key_delete(m_randomKey);
+            return false;
+        }
+        m_meta = static_cast<SlotMeta *>(meta);
+        m_freeSlots = reinterpret_cast<uint32_t *>(m_meta + slots);
+        for (uint32_t i = 0; i < slots; ++i) {
+            m_freeSlots[i] = i;
+        }
+        m_freeHead = 0;
+        m_freeCount = slots;
+        m_slots = slots;
+        m_sampleRate = sampleRate;
+        m_libraryFilter = libraryFilter;
+        m_poolStart = reinterpret_cast<uintptr_t>(pool);
+        m_poolEnd = m_poolStart + poolSize;
+        m_replaceGot = replaceGot;
+        m_enabled.store(true);
+
+        // 向CrashHandler注册，崩溃时输出分配/释放栈
+        void *registerFn = FindNativeCrashSymbol("and_crash_register_fault_describer");
+        if (registerFn) {
+            reinterpret_cast<RegisterDescriber>(registerFn)(Describe);
+        }
+        int hooked = InstallHooks();
+        __android_log_print(ANDROID_LOG_INFO, "AndCrash", "guarded allocator: 1/%u, %u slots, %d GOT entries hooked",
+                            sampleRate, slots, hooked);
+        return true;
+    }
+
+    int GuardedAllocator::InstallHooks() {
+        auto replace = reinterpret_cast<ReplaceGot>(m_replaceGot);
+        // dlopen后会再次调用，多个线程同时加载so时不能并发改同一页的权限
+        pthread_mutex_lock(&m_hookLock);
+        int hooked = replace("malloc", reinterpret_cast<void *>(apm_malloc), IsSampledLibrary);
+        hooked += replace("calloc", reinterpret_cast<void *>(apm_calloc), IsSampledLibrary);
+        hooked += replace("realloc", reinterpret_cast<void *>(apm_realloc), IsSampledLibrary);
+        hooked += replace("free", reinterpret_cast<void *>(apm_free), IsSampledLibrary);
+        hooked += replace("memalign", reinterpret_cast<void *>(Memalign), IsSampledLibrary);
+        hooked += replace("posix_memalign", reinterpret_cast<void *>(PosixMemalign), IsSampledLibrary);
+        hooked += replace("aligned_alloc", reinterpret_cast<void *>(AlignedAlloc), IsSampledLibrary);
+        hooked += replace("malloc_usable_size", reinterpret_cast<void *>(MallocUsableSize), IsSampledLibrary);
+        hooked += replace("getdelim", reinterpret_cast<void *>(Getdelim), IsSampledLibrary);
+        hooked += replace("getline", reinterpret_cast<void *>(Getline), IsSampledLibrary);
+        if (m_realDlopen) {
+            hooked += replace("dlopen", reinterpret_cast<void *>(Dlopen), IsLoaderCaller);
+        }
+        if (m_realDlopenExt) {
+            hooked += replace("android_dlopen_ext", reinterpret_cast<void *>(AndroidDlopenExt), IsLoaderCaller);
+        }
+        pthread_mutex_unlock(&m_hookLock);
+        return hooked;
+    }
+
+    bool GuardedAllocator::IsSampledLibrary(const char *path) {
+        const char *name = BaseName(path);
+        // 本库和崩溃处理不参与采样：信号处理函数里的分配不能进入保护池的锁
+        return strstr(path, m_libraryFilter) && strcmp(name, "libapm.so") != 0
+               && strcmp(name, "libnativeCrash.so") != 0;
+    }
+
+    bool GuardedAllocator::IsLoaderCaller(const char *path) {
+        // System.loadLibrary经libnativeloader等系统库调用android_dlopen_ext，所以除本库外都要替换
+        const char *name = BaseName(path);
+        return *name && strcmp(name, "libapm.so") != 0;
+    }
+
+    void *GuardedAllocator::Dlopen(const char *filename, int flags) {
+        // 经bionic的__loader_dlopen传入原调用方地址，否则会按libapm所在的命名空间查找
+        void *handle = m_loaderDlopen ? m_loaderDlopen(filename, flags, __builtin_return_address(0))
+                                      : m_realDlopen(filename, flags);
+        if (handle) {
+            InstallHooks();
+        }
+        return handle;
+    }
+
+    void *GuardedAllocator::AndroidDlopenExt(const char *filename, int flags, const void *extInfo) {
+        void *handle = m_loaderDlopenExt
+                       ? m_loaderDlopenExt(filename, flags, extInfo, __builtin_return_address(0))
+                       : m_realDlopenExt(filename, flags, extInfo);
+        if (handle) {
+            InstallHooks();
+        }
+        return handle;
+    }
+
+    bool GuardedAllocator::IsEnabled() {
+        return m_enabled.load(std::memory_order_acquire);
+    }
+
+    bool GuardedAllocator::ShouldSample() {
+        auto counter = (uintptr_t) pthread_getspecific(m_counterKey);
+        if (counter > 1) {
+            if (counter != kBusy) {
+                pthread_setspecific(m_counterKey, reinterpret_cast<void *>(counter - 1));
+            }
+            return false;
+        }
+        // 0表示本线程首次分配，先抽一个间隔，避免所有线程的第一次分配都被采样
+        bool sample = counter == 1 || m_sampleRate == 1;
+        counter = m_sampleRate > 1 ? 1 + NextRandom() % (2 * m_sampleRate - 1) : 1;
+        pthread_setspecific(m_counterKey, reinterpret_cast<void *>(counter));
+        return sample;
+    }
+
+    uintptr_t GuardedAllocator::EnterBusy() {
+        auto counter = (uintptr_t) pthread_getspecific(m_counterKey);
+        pthread_setspecific(m_counterKey, reinterpret_cast<void *>(kBusy));
+        return counter;
+    }
+
+    void GuardedAllocator::LeaveBusy(uintptr_t counter) {
+        pthread_setspecific(m_counterKey, reinterpret_cast<void *>(counter));
+    }
+
+    void *GuardedAllocator::Malloc(size_t size) {
+        if (!IsEnabled()) {
+            return malloc(size);
+        }
+        if (ShouldSample()) {
+            // 栈回溯等内部逻辑再进入malloc时不再采样
+            uintptr_t counter = EnterBusy();
+            void *ptr = Allocate(size, 0);
+            LeaveBusy(counter);
+            if (ptr) {
+                return ptr;
+            }
+        }
+        return m_realMalloc(size);
+    }
+
+    void *GuardedAllocator::Calloc(size_t count, size_t size) {
+        if (!IsEnabled()) {
+            return calloc(count, size);
+        }
+        size_t total;
+        if (__builtin_mul_overflow(count, size, &total)) {
+            return nullptr;
+        }
+        if (ShouldSample()) {
+            uintptr_t counter = EnterBusy();
+            void *ptr = Allocate(total, 0);
+            LeaveBusy(counter);
+            if (ptr) {
+                // 槽位复用时页内还有旧数据
+                memset(ptr, 0, total);
+                return ptr;
+            }
+        }
+        return m_realCalloc(count, size);
+    }
+
+    void *GuardedAllocator::Realloc(void *ptr, size_t size) {
+        if (!ptr) {
+            return Malloc(size);
+        }
+        if (!Contains(ptr)) {
+            return IsEnabled() ? m_realRealloc(ptr, size) : realloc(ptr, size);
+        }
+        if (size == 0) {
+            Free(ptr);
+            return nullptr;
+        }
+        return MoveToHeap(ptr, size);
+    }
+
+    void *GuardedAllocator::MoveToHeap(void *ptr, size_t size) {
+        auto addr = reinterpret_cast<uintptr_t>(ptr);
+        size_t pageIndex = (addr - m_poolStart) / m_pageSize;
+        if (pageIndex % 2 == 0) {
+            ReportAndAbort(ErrorType::InvalidFree, pageIndex / 2, addr);
+        }
+        size_t slot = (pageIndex - 1) / 2;
+        size_t oldSize = m_meta[slot].addr == addr ? m_meta[slot].size : 0;
+        uintptr_t counter = EnterBusy();
+        void *newPtr = m_realMalloc(size);
+        if (newPtr) {
+            memcpy(newPtr, ptr, oldSize < size ? oldSize : size);
+            Deallocate(ptr);
+        }
+        LeaveBusy(counter);
+        return newPtr;
+    }
+
+    void *GuardedAllocator::Memalign(size_t alignment, size_t size) {
+        if (!IsEnabled()) {
+            return memalign(alignment, size);
+        }
+        if (ShouldSample()) {
+            uintptr_t counter = EnterBusy();
+            void *ptr = Allocate(size, alignment);
+            LeaveBusy(counter);
+            if (ptr) {
+                return ptr;
+            }
+        }
+        return m_realMemalign(alignment, size);
+    }
+
+    int GuardedAllocator::PosixMemalign(void **memptr, size_t alignment, size_t size) {
+        if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+            return EINVAL;
+        }
+        void *ptr = Memalign(alignment, size);
+        if (!ptr) {
+            return ENOMEM;
+        }
+        *memptr = ptr;
+        return 0;
+    }
+
+    void *GuardedAllocator::AlignedAlloc(size_t alignment, size_t size) {
+        return Memalign(alignment, size);
+    }
+
+    size_t GuardedAllocator::MallocUsableSize(const void *ptr) {
+        if (!Contains(ptr)) {
+            return IsEnabled() ? m_realUsableSize(ptr) : malloc_usable_size(const_cast<void *>(ptr));
+        }
+        auto addr = reinterpret_cast<uintptr_t>(ptr);
+        size_t pageIndex = (addr - m_poolStart) / m_pageSize;
+        if (pageIndex % 2 == 0) {
+            ReportAndAbort(ErrorType::InvalidFree, pageIndex / 2, addr);
+        }
+        const SlotMeta &meta = m_meta[(pageIndex - 1) / 2];
+        return meta.addr == addr && !meta.freed ? meta.size : 0;
+    }
+
+    ssize_t GuardedAllocator::Getdelim(char **line, size_t *capacity, int delim, FILE *stream) {
+        // libc会realloc传入的缓冲区，池内的缓冲区先搬回libc的堆
+        if (line && capacity && *line && Contains(*line)) {
+            size_t size = *capacity ? *capacity : 1;
+            void *moved = MoveToHeap(*line, size);
+            if (!moved) {
+                errno = ENOMEM;
+                return -1;
+            }
+            *line = static_cast<char *>(moved);
+            *capacity = size;
+        }
+        return m_realGetdelim(line, capacity, delim, stream);
+    }
+
+    ssize_t GuardedAllocator::Getline(char **line, size_t *capacity, FILE *stream) {
+        return Getdelim(line, capacity, '\n', stream);
+    }
+
+    void GuardedAllocator::Free(void *ptr) {
+        if (Contains(ptr)) {
+            uintptr_t counter = EnterBusy();
+            Deallocate(ptr);
+            LeaveBusy(counter);
+        } else if (IsEnabled()) {
+            m_realFree(ptr);
+        } else {
+            free(ptr);
+        }
+    }
+
+    bool GuardedAllocator::Contains(const void *ptr) {
+        auto p = reinterpret_cast<uintptr_t>(ptr);
+        return p >= m_poolStart && p < m_poolEnd;
+    }
+
+    uintptr_t GuardedAllocator::SlotStart(size_t slot) {
+        return m_poolStart + (2 * slot + 1) * m_pageSize;
+    }
+
+    void *GuardedAllocator::Allocate(size_t size, size_t alignment) {
+        if (size == 0) {
+            size = 1;
+        }
+        if (alignment < 16) {
+            alignment = 16;
+        }
+        if (size > m_pageSize || alignment > m_pageSize || (alignment & (alignment - 1)) != 0) {
+            return nullptr;
+        }
+        while (m_lock.test_and_set(std::memory_order_acquire)) {
+        }
+        if (m_freeCount == 0) {
+            m_lock.clear(std::memory_order_release);
+            return nullptr;
+        }
+        uint32_t slot = m_freeSlots[m_freeHead];
+        m_freeHead = (m_freeHead + 1) % m_slots;
+        m_freeCount--;
+        m_lock.clear(std::memory_order_release);
+
+        uintptr_t page = SlotStart(slot);
+        if (mprotect(reinterpret_cast<void *>(page), m_pageSize, PROT_READ | PROT_WRITE) != 0) {
+            return nullptr;
+        }
+        // 随机贴左（检测下溢）或贴右（检测上溢），贴右时按alignment（至少16字节）对齐
+        uintptr_t addr = page;
+        if (NextRandom() & 1) {
+            addr = (page + m_pageSize - size) & ~(uintptr_t) (alignment - 1);
+        }
+        SlotMeta &meta = m_meta[slot];
+        meta.size = size;
+        meta.freed = false;
+        meta.dealloc.depth = 0;
+        Record(meta.alloc);
+        meta.addr = addr;
+        return reinterpret_cast<void *>(addr);
+    }
+
+    void GuardedAllocator::Deallocate(void *ptr) {
+        auto addr = reinterpret_cast<uintptr_t>(ptr);
+        size_t pageIndex = (addr - m_poolStart) / m_pageSize;
+        if (pageIndex % 2 == 0) {
+            ReportAndAbort(ErrorType::InvalidFree, pageIndex / 2, addr);
+        }
+        size_t slot = (pageIndex - 1) / 2;
+        SlotMeta &meta = m_meta[slot];
+        if (meta.addr != addr) {
+            ReportAndAbort(ErrorType::InvalidFree, slot, addr);
+        }
+        if (meta.freed) {
+            ReportAndAbort(ErrorType::DoubleFree, slot, addr);
+        }
+        Record(meta.dealloc);
+        meta.freed = true;
+        // 释放后整页不可访问，之后的访问即为UAF
+        mprotect(reinterpret_cast<void *>(SlotStart(slot)), m_pageSize, PROT_NONE);
+
+        while (m_lock.test_and_set(std::memory_order_acquire)) {
+        }
+        m_freeSlots[(m_freeHead + m_freeCount) % m_slots] = (uint32_t) slot;
+        m_freeCount++;
+        m_lock.clear(std::memory_order_release);
+    }
+
+    void GuardedAllocator::Record(Trace &trace) {
+        BacktraceState state{trace.frames, trace.frames + kMaxFrames};
+        _Unwind_Backtrace(UnwindCallback, &state);
+        trace.depth = (uint32_t) (state.current - trace.frames);
+        trace.tid = (pid_t) syscall(SYS_gettid);
+    }
+
+    void GuardedAllocator::ReportAndAbort(ErrorType type, size_t slot, uintptr_t addr) {
+        m_errorSlot = slot;
+        m_errorAddr = addr;
+        m_errorType.store((uint32_t) type);
+        abort();
+    }
+
+    const char *GuardedAllocator::ErrorName(ErrorType type) {
+        switch (type) {
+            case ErrorType::UseAfterFree:
+                return "use-after-free";
+            case ErrorType::BufferOverflow:
+                return "buffer-overflow";
+            case ErrorType::BufferUnderflow:
+                return "buffer-underflow";
+            case ErrorType::DoubleFree:
+                return "double-free";
+            case ErrorType::InvalidFree:
+                return "invalid-free";
+            default:
+                return "unknown";
+        }
+    }
+
+    void GuardedAllocator::WriteTrace(int fd, const char *title, const Trace &trace) {
+        dprintf(fd, "%s by thread %d:\n", title, trace.tid);
+        for (uint32_t i = 0; i < trace.depth && i < kMaxFrames; ++i) {
+            Dl_info info{};
+            if (dladdr(reinterpret_cast<void *>(trace.frames[i]), &info) && info.dli_fname) {
+                const char *name = info.dli_sname ?: "??";
+                dprintf(fd, "  #%02u pc %08" PRIxPTR " %s (%s+%#" PRIxPTR ")\n",
+                        i,
+                        trace.frames[i] - (uintptr_t) info.dli_fbase,
+                        info.dli_fname,
+                        name,
+                        trace.frames[i] - (uintptr_t) info.dli_saddr);
+            } else {
+                dprintf(fd, "  #%02u pc %08" PRIxPTR "\n", i, trace.frames[i]);
+            }
+        }
+    }
+
+    /**
+     * 信号处理函数中调用，只读元数据，不加锁
+     */
+    bool GuardedAllocator::Describe(void *faultAddr, int fd) {
+        if (!m_enabled.load()) {
+            return false;
+        }
+        auto type = (ErrorType) m_errorType.load();
+        size_t slot;
+        uintptr_t addr;
+        if (type != ErrorType::None) {
+            slot = m_errorSlot;
+            addr = m_errorAddr;
+        } else {
+            addr = reinterpret_cast<uintptr_t>(faultAddr);
+            if (!Contains(faultAddr)) {
+                return false;
+            }
+            size_t pageIndex = (addr - m_poolStart) / m_pageSize;
+            if (pageIndex % 2 == 1) {
+                slot = (pageIndex - 1) / 2;
+                type = m_meta[slot].freed ? ErrorType::UseAfterFree : ErrorType::None;
+            } else {
+                // 落在保护页：取左右两侧离得最近的分配
+                size_t right = pageIndex / 2;
+                bool hasLeft = pageIndex > 0 && m_meta[right - 1].addr != 0;
+                bool hasRight = right < m_slots && m_meta[right].addr != 0;
+                uintptr_t leftDistance = hasLeft ? addr - (m_meta[right - 1].addr + m_meta[right - 1].size) : UINTPTR_MAX;
+                uintptr_t rightDistance = hasRight ? m_meta[right].addr - addr : UINTPTR_MAX;
+                if (!hasLeft && !hasRight) {
+                    return false;
+                }
+                slot = leftDistance <= rightDistance ? right - 1 : right;
+                type = slot == right ? ErrorType::BufferUnderflow : ErrorType::BufferOverflow;
+                if (m_meta[slot].freed) {
+                    type = ErrorType::UseAfterFree;
+                }
+            }
+        }
+        if (slot >= m_slots) {
+            return false;
+        }
+        const SlotMeta &meta = m_meta[slot];
+        dprintf(fd, "\nGuarded Allocator:\n");
+        dprintf(fd, "Error: %s\n", ErrorName(type));
+        if (addr >= meta.addr) {
+            dprintf(fd, "Address: %#" PRIxPTR " (%zu bytes from the start of a %zu-byte allocation at %#" PRIxPTR ")\n",
+                    addr, (size_t) (addr - meta.addr), meta.size, meta.addr);
+        } else {
+            dprintf(fd, "Address: %#" PRIxPTR " (%zu bytes left of a %zu-byte allocation at %#" PRIxPTR ")\n",
+                    addr, (size_t) (meta.addr - addr), meta.size, meta.addr);
+        }
+        WriteTrace(fd, "Allocated", meta.alloc);
+        if (meta.freed) {
+            WriteTrace(fd, "Deallocated", meta.dealloc);
+        }
+        return true;
+    }
+
+} // apm
+
+// C接口：GOT hook的替换目标，也可由业务native代码直接调用
+extern "C" {
+
+__attribute__((visibility("default"))) void *apm_malloc(size_t size) {
+    return apm::GuardedAllocator::Malloc(size);
+}
+
+__attribute__((visibility("default"))) void *apm_calloc(size_t count, size_t size) {
+    return apm::GuardedAllocator::Calloc(count, size);
+}
+
+__attribute__((visibility("default"))) void *apm_realloc(void *ptr, size_t size) {
+    return apm::GuardedAllocator::Realloc(ptr, size);
+}
+
+__attribute__((visibility("default"))) void apm_free(void *ptr) {
+    apm::GuardedAllocator::Free(ptr);
+}
+
+}
@@ -0,0 +1,186 @@
+#ifndef ANDROIDPERFORMANCEMONITORING_GUARDED_ALLOCATOR_H
+#define ANDROIDPERFORMANCEMONITORING_GUARDED_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <pthread.h>
+#include <sys/types.h>
+
+namespace apm {
+
+    /**
+     * 采样保护分配器（GWP-ASan思路）
+     *
+     * 每N次分配抽样一次，放入预分配的保护页池：每个槽位一页，前后都是PROT_NONE保护页，
+     * 分配右对齐到页尾，越界访问直接落到保护页；释放后整页置为PROT_NONE，UAF同样触发SIGSEGV。
+     * 分配/释放栈记录在固定大小的元数据表中，崩溃时由CrashHandler写入报告。
+     * 未被采样的分配只多一次线程局部计数器递减。
+     *
+     * 通过nativeCrash导出的GOT hook接管路径匹配libraryFilter的so（默认为应用自己的so）的
+     * malloc/calloc/realloc/free/memalign/posix_memalign/aligned_alloc/malloc_usable_size，其余so不做任何替换。
+     * dlopen/android_dlopen_ext同样被hook，之后加载的so在加载完成后补上替换。
+     * 采样的内存不能交给未被接管的代码释放或realloc：libc里会realloc调用方缓冲区的getline/getdelim
+     * 在匹配的so中被替换，先把缓冲区搬回libc的堆；其他按约定转移所有权的场景需要让两端的so都匹配libraryFilter。
+     * 线程局部状态使用pthread_key（emutls首次访问会malloc，API 29以下会递归进入hook）。
+     */
+    class GuardedAllocator final {
+    public:
+        static constexpr size_t kMaxFrames = 16;
+        static constexpr uint32_t kDefaultSampleRate = 5000;
+        static constexpr uint32_t kDefaultSlots = 64;
+        // 应用安装目录/私有目录下的so
+        static constexpr const char *kAppLibraries = "/data/";
+
+        // 启用（只能成功一次）：接管libraryFilter匹配的so的分配，并向nativeCrash注册故障描述回调
+        static bool Enable(uint32_t sampleRate, uint32_t slots, const char *libraryFilter = kAppLibraries);
+
+        static bool IsEnabled();
+
+        static void *Malloc(size_t size);
+
+        static void *Calloc(size_t count, size_t size);
+
+        static void *Realloc(void *ptr, size_t size);
+
+        static void Free(void *ptr);
+
+        static void *Memalign(size_t alignment, size_t size);
+
+        static int PosixMemalign(void **memptr, size_t alignment, size_t size);
+
+        static void *AlignedAlloc(size_t alignment, size_t size);
+
+        static size_t MallocUsableSize(const void *ptr);
+
+        // 地址在保护池内时写入错误类型和分配/释放栈（信号处理函数中调用），否则返回false
+        static bool Describe(void *faultAddr, int fd);
+
+        GuardedAllocator(const GuardedAllocator &) = delete;
+
+        void operator=(const GuardedAllocator &) = delete;
+
+    private:
+        enum class ErrorType : uint32_t {
+            None, UseAfterFree, BufferOverflow, BufferUnderflow, DoubleFree, InvalidFree
+        };
+
+        struct Trace {
+            uintptr_t frames[kMaxFrames];
+            uint32_t depth;
+            pid_t tid;
+        };
+
+        struct SlotMeta {
+            uintptr_t addr;   // 0表示槽位从未使用
+            size_t size;
+            bool freed;
+            Trace alloc;
+            Trace dealloc;
+        };
+
+        typedef void *(*MallocFn)(size_t);
+
+        typedef void *(*CallocFn)(size_t, size_t);
+
+        typedef void *(*ReallocFn)(void *, size_t);
+
+        typedef void (*FreeFn)(void *);
+
+        typedef void *(*MemalignFn)(size_t, size_t);
+
+        typedef size_t (*UsableSizeFn)(const void *);
+
+        typedef ssize_t (*GetdelimFn)(char **, size_t *, int, FILE *);
+
+        typedef void *(*DlopenFn)(const char *, int);
+
+        typedef void *(*DlopenExtFn)(const char *, int, const void *);
+
+        // bionic的linker入口，需要传入真实的调用方地址来确定命名空间
+        typedef void *(*LoaderDlopenFn)(const char *, int, const void *);
+
+        typedef void *(*LoaderDlopenExtFn)(const char *, int, const void *, const void *);
+
+        // 线程正在执行分配器内部逻辑时计数器的取值，此时再进入的分配直接走libc
+        static constexpr uintptr_t kBusy = UINTPTR_MAX;
+
+        static int InstallHooks();
+
+        static bool IsSampledLibrary(const char *path);
+
+        static bool IsLoaderCaller(const char *path);
+
+        // 把池内的内存搬到libc的堆上（不产生新的采样）并释放槽位
+        static void *MoveToHeap(void *ptr, size_t size);
+
+        static ssize_t Getdelim(char **line, size_t *capacity, int delim, FILE *stream);
+
+        static ssize_t Getline(char **line, size_t *capacity, FILE *stream);
+
+        static void *Dlopen(const char *filename, int flags);
+
+        static void *AndroidDlopenExt(const char *filename, int flags, const void *extInfo);
+
+        static uintptr_t EnterBusy();
+
+        static void LeaveBusy(uintptr_t counter);
+
+        static uint32_t NextRandom();
+
+        static bool ShouldSample();
+
+        // alignment为0或2的幂且不超过一页，否则返回nullptr
+        static void *Allocate(size_t size, size_t alignment);
+
+        static void Deallocate(void *ptr);
+
+        static bool Contains(const void *ptr);
+
+        static uintptr_t SlotStart(size_t slot);
+
+        static void Record(Trace &trace);
+
+        [[noreturn]] static void ReportAndAbort(ErrorType type, size_t slot, uintptr_t addr);
+
+        static void WriteTrace(int fd, const char *title, const Trace &trace);
+
+        static const char *ErrorName(ErrorType type);
+
+        static uintptr_t m_poolStart;
+        static uintptr_t m_poolEnd;
+        static size_t m_pageSize;
+        static uint32_t m_slots;
+        static uint32_t m_sampleRate;
+        static SlotMeta *m_meta;
+        static uint32_t *m_freeSlots;   // 空闲槽位环形队列，释放的槽位放到队尾，尽量晚复用
+        static uint32_t m_freeHead;
+        static uint32_t m_freeCount;
+        static std::atomic_flag m_lock;
+        static pthread_key_t m_counterKey;     // 距下次采样的分配次数（值即计数，不分配内存）
+        static pthread_key_t m_randomKey;
+        static const char *m_libraryFilter;
+        static MallocFn m_realMalloc;
+        static CallocFn m_realCalloc;
+        static ReallocFn m_realRealloc;
+        static FreeFn m_realFree;
+        static MemalignFn m_realMemalign;
+        static UsableSizeFn m_realUsableSize;
+        static GetdelimFn m_realGetdelim;
+        static DlopenFn m_realDlopen;
+        static DlopenExtFn m_realDlopenExt;
+        static LoaderDlopenFn m_loaderDlopen;
+        static LoaderDlopenExtFn m_loaderDlopenExt;
+        static void *m_replaceGot;
+        static pthread_mutex_t m_hookLock;
+        static std::atomic_bool m_enabled;
+        // 主动检测到的错误（double free等），随后abort()由CrashHandler读取
+        static std::atomic<uint32_t> m_errorType;
+        static size_t m_errorSlot;
+        static uintptr_t m_errorAddr;
+    };
+
+} // apm
+
+#endif //ANDROIDPERFORMANCEMONITORING_GUARDED_ALLOCATOR_H
@@ -3,6 +3,9 @@ package com.github.crash;
 
 //Java <- apm_bridge.cpp -> C++
 public class AndAPM {
+    public static final int DEFAULT_SAMPLE_RATE = 5000;
+    public static final int DEFAULT_GUARDED_SLOTS = 64;
+
     static {
         System.loadLibrary("apm");
     }
@@ -26,6 +29,17 @@ public class AndAPM {
         nativeHandle = 0;
     }
 
+    /**
+     * 开启采样保护分配器：接管应用自己的so（已加载的）的malloc/free，每sampleRate次分配抽样一次放入保护页池，
+     * 检测UAF/越界，崩溃报告中会带上分配和释放栈。需在NativeCrash初始化、业务so加载之后调用
+     * @param sampleRate 采样率，例如{@link #DEFAULT_SAMPLE_RATE}
+     * @param slots 保护池槽位数（每个槽位占两页）
+     * @return nativeCrash未加载或已开启过时返回false
+     */
+    public static boolean enableGuardedAllocator(int sampleRate, int slots) {
+        return nativeEnableGuardedAllocator(sampleRate, slots);
+    }
+
     private static native long nativeInit();
 
     private native void nativeStart(long nativeHandle);
@@ -34,4 +48,6 @@ public class AndAPM {
 
     private native void nativeDestroy(long nativeHandle);
 
+    private static native boolean nativeEnableGuardedAllocator(int sampleRate, int slots);
+
 }
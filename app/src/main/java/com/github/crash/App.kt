@@ -1,6 +1,7 @@
 package com.github.crash
 
 import android.app.Application
+import android.content.pm.ApplicationInfo
 import android.util.Log
 import com.github.andcrash.jcrash.AndCrash
 import com.github.andcrash.nativecrash.NativeCrash
@@ -12,13 +13,23 @@ import java.io.File
 class App : Application(), NativeCrashCallback {
     override fun onCreate() {
         super.onCreate()
+        // debug包上传到本地目录，每个压缩包传完后逐块校验
+        val debuggable = applicationInfo.flags and ApplicationInfo.FLAG_DEBUGGABLE != 0
+        val uploader = if (debuggable) {
+            LocalFileUploader(File(filesDir, "upload_mirror"), 64 * 1024)
+        } else {
+            OkHttpUploader("https://api.example.com/crash_logs")
+        }
         AndCrash.getInstance()
-            .setUploader(OkHttpUploader("https://api.example.com/crash_logs"))
+            .setUploader(uploader)
             .setRetentionDays(3)
             .addCrashHandler(CustomUncaughtExceptionHandler())
             .initialize(this)
             .initNativeCrash(this, "1.0.00", this)
-
+        // 采样保护分配器是按需开启的诊断手段，只在debug包上启用
+        if (debuggable) {
+            AndAPM.enableGuardedAllocator(AndAPM.DEFAULT_SAMPLE_RATE, AndAPM.DEFAULT_GUARDED_SLOTS)
+        }
 
         val andAPM = AndAPM()
         andAPM.init()
@@ -38,7 +49,7 @@ class App : Application(), NativeCrashCallback {
     }
 
     /**
-     * 初始化完成时回调，可用于上传Native crash日志
+     * 初始化完成时回调，可用于上传Native crash日志（设置了uploader时由AndCrash打包上传，不会回调）
      */
     override fun onCrashUpload(crashLogPath: Array<out File>) {
         crashLogPath.forEach {
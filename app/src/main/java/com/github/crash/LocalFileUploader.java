@@ -0,0 +1,89 @@
+package com.github.crash;
+
+
+import android.util.Log;
+
+import com.github.andcrash.jcrash.LogUploader;
+import com.github.andcrash.jcrash.UploadCallback;
+import com.github.andcrash.nativecrash.NativeCrash;
+
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
+
+/**
+ * 本地文件上传替身：把文件按requestBytes分段“发送”到targetDir，模拟分段请求与断点续传，
+ * 用于联调打包格式。每段成功后把已确认偏移写入.offset文件，中断后从该偏移继续；
+ * 传完的.acpk压缩包会逐块校验
+ */
+public class LocalFileUploader implements LogUploader {
+    private final File targetDir;
+    private final long requestBytes;
+
+    public LocalFileUploader(File targetDir, long requestBytes) {
+        this.targetDir = targetDir;
+        this.requestBytes = requestBytes;
+    }
+
+    @Override
+    public void upload(File logFile, UploadCallback callback) {
+        File target = new File(targetDir, logFile.getName());
+        File offsetFile = new File(targetDir, logFile.getName() + ".offset");
+        try {
+            if (!targetDir.exists() && !targetDir.mkdirs()) {
+                throw new IOException("Failed to create " + targetDir);
+            }
+            long offset = Math.min(readOffset(offsetFile), target.length());
+            int requests = 0;
+            try (FileChannel in = new FileInputStream(logFile).getChannel();
+                 FileChannel out = new RandomAccessFile(target, "rw").getChannel()) {
+                long size = in.size();
+                out.truncate(offset);
+                while (offset < size) {
+                    // transferTo底层走sendfile
+                    long sent = in.transferTo(offset, Math.min(requestBytes, size - offset), out.position(offset));
+                    if (sent <= 0) {
+                        throw new IOException("transfer stalled at " + offset);
+                    }
+                    offset += sent;
+                    writeOffset(offsetFile, offset);
+                    requests++;
+                }
+            }
+            if (logFile.getName().endsWith(".acpk") && !NativeCrash.verifyPackage(target.getAbsolutePath())) {
+                // 已传内容不可信，下次从头传
+                target.delete();
+                offsetFile.delete();
+                throw new IOException("package verify failed: " + target);
+            }
+            offsetFile.delete();
+            Log.d("AndCrash", "upload:" + logFile.getName() + " in " + requests + " requests");
+            callback.onSuccess(logFile);
+        } catch (IOException e) {
+            callback.onFailure(logFile, e);
+        }
+    }
+
+    private static long readOffset(File offsetFile) {
+        if (!offsetFile.exists()) {
+            return 0;
+        }
+        try (FileInputStream in = new FileInputStream(offsetFile)) {
+            byte[] buf = new byte[32];
+            int n = in.read(buf);
+            return n > 0 ? Long.parseLong(new String(buf, 0, n, StandardCharsets.US_ASCII).trim()) : 0;
+        } catch (IOException | NumberFormatException e) {
+            return 0;
+        }
+    }
+
+    private static void writeOffset(File offsetFile, long offset) throws IOException {
+        try (FileOutputStream out = new FileOutputStream(offsetFile)) {
+            out.write(Long.toString(offset).getBytes(StandardCharsets.US_ASCII));
+        }
+    }
+}
@@ -0,0 +1,188 @@
+#ifndef NATIVE_BENCH_BENCH_UTIL_H
+#define NATIVE_BENCH_BENCH_UTIL_H
+
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "crash_storage.h"
+#include "native_crash_handler.h"
+
+namespace bench {
+
+    inline uint64_t NowNs() {
+        struct timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+    }
+
+    // 单项基准结果：ns样本 + 附加指标（吞吐、帧数等）
+    struct Result {
+        std::string name;
+        std::vector<uint64_t> samples;
+        std::vector<std::pair<std::string, double>> metrics;
+
+        void metric(const std::string &key, double value) {
+            metrics.emplace_back(key, value);
+        }
+    };
+
+    /**
+     * 结果以JSON输出，便于版本间对比：
+     * {"results":[{"name":..,"iterations":..,"min_ns":..,"mean_ns":..,"p50_ns":..,"p99_ns":..,"max_ns":..,...}]}
+     */
+    class Reporter {
+    public:
+        void add(Result result) {
+            m_results.push_back(std::move(result));
+        }
+
+        bool write(const char *path) const {
+            FILE *out = path ? fopen(path, "w") : stdout;
+            if (!out) {
+                return false;
+            }
+            fprintf(out, "{\"results\":[");
+            for (size_t i = 0; i < m_results.size(); ++i) {
+                const Result &r = m_results[i];
+                std::vector<uint64_t> s = r.samples;
+                std::sort(s.begin(), s.end());
+                uint64_t sum = 0;
+                for (uint64_t v: s) sum += v;
+                auto pct = [&s](double p) -> uint64_t {
+                    return s.empty() ? 0 : s[std::min(s.size() - 1, (size_t) (p * (double) s.size()))];
+                };
+                fprintf(out, "%s\n  {\"name\":\"%s\",\"iterations\":%zu", i ? "," : "", r.name.c_str(), s.size());
+                if (!s.empty()) {
+                    fprintf(out, ",\"min_ns\":%llu,\"mean_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu",
+                            (unsigned long long) s.front(), (unsigned long long) (sum / s.size()),
+                            (unsigned long long) pct(0.5), (unsigned long long) pct(0.99),
+                            (unsigned long long) s.back());
+                }
+                for (const auto &m: r.metrics) {
+                    fprintf(out, ",\"%s\":%.3f", m.first.c_str(), m.second);
+                }
+                fprintf(out, "}");
+            }
+            fprintf(out, "\n]}\n");
+            if (out != stdout) {
+                fclose(out);
+            }
+            return true;
+        }
+
+    private:
+        std::vector<Result> m_results;
+    };
+
+    // 子进程运行结果
+    struct ChildResult {
+        int status = 0;
+        bool timedOut = false;
+        uint64_t elapsedNs = 0;   // 子进程上报的起点 -> 父进程回收
+    };
+
+    /**
+     * fork子进程执行body，子进程通过mark()上报计时起点（例如触发信号前一刻），
+     * 父进程在回收时计算耗时；超时则SIGKILL
+     */
+    inline ChildResult RunChild(const std::function<void(const std::function<void()> &mark)> &body,
+                                int timeoutMs = 10000) {
+        ChildResult result;
+        int pipeFd[2];
+        if (pipe(pipeFd) != 0) {
+            result.status = -1;
+            return result;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(pipeFd[0]);
+            int wfd = pipeFd[1];
+            body([wfd]() {
+                uint64_t t = NowNs();
+                write(wfd, &t, sizeof(t));
+            });
+            _exit(0);
+        }
+        close(pipeFd[1]);
+        uint64_t start = 0;
+        uint64_t deadline = NowNs() + (uint64_t) timeoutMs * 1000000ULL;
+        while (true) {
+            pid_t r = waitpid(pid, &result.status, WNOHANG);
+            if (r == pid) {
+                break;
+            }
+            if (NowNs() > deadline) {
+                kill(pid, SIGKILL);
+                waitpid(pid, &result.status, 0);
+                result.timedOut = true;
+                break;
+            }
+            struct timespec delay = {0, 100 * 1000};
+            nanosleep(&delay, nullptr);
+        }
+        uint64_t end = NowNs();
+        if (read(pipeFd[0], &start, sizeof(start)) == (ssize_t) sizeof(start)) {
+            result.elapsedNs = end - start;
+        }
+        close(pipeFd[0]);
+        return result;
+    }
+
+    inline std::string MakeTempDir(const char *prefix) {
+        std::string tmpl = std::string(getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp") + "/" + prefix + "XXXXXX";
+        std::vector<char> buf(tmpl.begin(), tmpl.end());
+        buf.push_back('\0');
+        return mkdtemp(buf.data()) ? std::string(buf.data()) : std::string();
+    }
+
+    // 目录下第一个crash-*.log文件内容
+    inline std::string ReadCrashReport(const std::string &dir) {
+        std::string content;
+        DIR *d = opendir(dir.c_str());
+        if (!d) {
+            return content;
+        }
+        struct dirent *e;
+        while ((e = readdir(d)) != nullptr) {
+            if (strncmp(e->d_name, "crash-", 6) != 0) continue;
+            int fd = open((dir + "/" + e->d_name).c_str(), O_RDONLY);
+            char buf[4096];
+            ssize_t n;
+            while (fd != -1 && (n = read(fd, buf, sizeof(buf))) > 0) {
+                content.append(buf, (size_t) n);
+            }
+            if (fd != -1) close(fd);
+            break;
+        }
+        closedir(d);
+        return content;
+    }
+
+    inline void RemoveTree(const std::string &dir) {
+        CrashStorage::RemoveDirectory(AT_FDCWD, dir.c_str());
+    }
+
+    // 等待CrashHandler::Init在分发线程上的延迟初始化完成（最多5秒）
+    inline bool WaitDeferredInit() {
+        for (int i = 0; i < 5000 && !CrashHandler::DeferredInitCostNs(); ++i) {
+            usleep(1000);
+        }
+        return CrashHandler::DeferredInitCostNs() != 0;
+    }
+
+} // bench
+
+#endif //NATIVE_BENCH_BENCH_UTIL_H
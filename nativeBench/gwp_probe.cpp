@@ -0,0 +1,13 @@
+/**
+ * signal_stress在GuardedAllocator::Enable之后dlopen的so，验证之后加载的so同样被GOT hook接管
+ */
+#include <cstdlib>
+
+extern "C" __attribute__((visibility("default"))) void gwp_probe_use_after_free() {
+    // 经函数指针调用，避免编译器按malloc语义优化掉
+    void *(*volatile allocate)(size_t) = malloc;
+    void (*volatile release)(void *) = free;
+    auto *p = static_cast<volatile char *>(allocate(32));
+    release((void *) p);
+    p[0] = 1;
+}
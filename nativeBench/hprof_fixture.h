@@ -0,0 +1,224 @@
+#ifndef NATIVE_BENCH_HPROF_FIXTURE_H
+#define NATIVE_BENCH_HPROF_FIXTURE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+    /**
+     * 生成合成hprof：Holder.sItems -> Object[]分块 -> Node链，末尾挂若干Leaked实例，
+     * 另有一部分Leaked只被WeakReference持有（不应出现在结果中）
+     */
+    class HprofWriter {
+    public:
+        explicit HprofWriter(FILE *out) : m_out(out) {
+            const char version[] = "JAVA PROFILE 1.0.3";
+            fwrite(version, 1, sizeof(version), m_out);
+            std::string h;
+            u4(h, 4);
+            u4(h, 0);
+            u4(h, 0);
+            fwrite(h.data(), 1, h.size(), m_out);
+        }
+
+        uint32_t string(const char *s) {
+            std::string body;
+            uint32_t id = m_nextStringId++;
+            u4(body, id);
+            body.append(s);
+            record(0x01, body);
+            return id;
+        }
+
+        void loadClass(uint32_t classId, const char *name) {
+            std::string body;
+            u4(body, m_nextSerial++);
+            u4(body, classId);
+            u4(body, 0);
+            u4(body, string(name));
+            record(0x02, body);
+        }
+
+        // fields: <名字, 类型>
+        void classDump(uint32_t classId, uint32_t superId,
+                       const std::vector<std::pair<const char *, uint8_t>> &fields,
+                       const char *staticName = nullptr, uint32_t staticValue = 0) {
+            std::vector<uint32_t> names;
+            for (const auto &f: fields) names.push_back(string(f.first));
+            uint32_t staticNameId = staticName ? string(staticName) : 0;
+            std::string &b = m_segment;
+            b.push_back(0x20);
+            u4(b, classId);
+            u4(b, 0);
+            u4(b, superId);
+            for (int i = 0; i < 5; ++i) u4(b, 0);
+            u4(b, 0);
+            u2(b, 0);
+            u2(b, staticName ? 1 : 0);
+            if (staticName) {
+                u4(b, staticNameId);
+                b.push_back(2);
+                u4(b, staticValue);
+            }
+            u2(b, (uint16_t) fields.size());
+            for (size_t i = 0; i < fields.size(); ++i) {
+                u4(b, names[i]);
+                b.push_back((char) fields[i].second);
+            }
+            maybeFlush();
+        }
+
+        void instance(uint32_t id, uint32_t classId, const std::string &values) {
+            std::string &b = m_segment;
+            b.push_back(0x21);
+            u4(b, id);
+            u4(b, 0);
+            u4(b, classId);
+            u4(b, (uint32_t) values.size());
+            b.append(values);
+            maybeFlush();
+        }
+
+        void objectArray(uint32_t id, uint32_t classId, const std::vector<uint32_t> &elements) {
+            std::string &b = m_segment;
+            b.push_back(0x22);
+            u4(b, id);
+            u4(b, 0);
+            u4(b, (uint32_t) elements.size());
+            u4(b, classId);
+            for (uint32_t e: elements) u4(b, e);
+            maybeFlush();
+        }
+
+        void root(uint8_t tag, uint32_t id) {
+            m_segment.push_back((char) tag);
+            u4(m_segment, id);
+            maybeFlush();
+        }
+
+        void finish() {
+            flush();
+            record(0x2c, std::string());
+        }
+
+        static void u2(std::string &b, uint16_t v) {
+            b.push_back((char) (v >> 8));
+            b.push_back((char) v);
+        }
+
+        static void u4(std::string &b, uint32_t v) {
+            b.push_back((char) (v >> 24));
+            b.push_back((char) (v >> 16));
+            b.push_back((char) (v >> 8));
+            b.push_back((char) v);
+        }
+
+    private:
+        void record(uint8_t tag, const std::string &body) {
+            std::string h;
+            h.push_back((char) tag);
+            u4(h, 0);
+            u4(h, (uint32_t) body.size());
+            fwrite(h.data(), 1, h.size(), m_out);
+            fwrite(body.data(), 1, body.size(), m_out);
+        }
+
+        void maybeFlush() {
+            if (m_segment.size() > (8u << 20)) {
+                flush();
+            }
+        }
+
+        void flush() {
+            if (!m_segment.empty()) {
+                record(0x1c, m_segment);
+                m_segment.clear();
+            }
+        }
+
+        FILE *m_out;
+        std::string m_segment;
+        uint32_t m_nextStringId = 1;
+        uint32_t m_nextSerial = 1;
+    };
+
+    const uint32_t kObjectClass = 1, kReferenceClass = 2, kWeakClass = 3, kHolderClass = 4,
+            kNodeClass = 5, kLeakedClass = 6, kArrayClass = 7;
+    const uint32_t kFirstObject = 0x1000;
+
+    // indexed：Object[]中直接引用的Node个数（默认全部），其余Node只能沿Node.next到达
+    inline size_t GenerateHprof(const std::string &path, uint32_t nodes, uint32_t leaks, uint32_t indexed = UINT32_MAX) {
+        FILE *out = fopen(path.c_str(), "wb");
+        if (!out) {
+            return 0;
+        }
+        HprofWriter w(out);
+        w.loadClass(kObjectClass, "java.lang.Object");
+        w.loadClass(kReferenceClass, "java.lang.ref.Reference");
+        w.loadClass(kWeakClass, "java.lang.ref.WeakReference");
+        w.loadClass(kHolderClass, "com.bench.Holder");
+        w.loadClass(kNodeClass, "com.bench.Node");
+        w.loadClass(kLeakedClass, "com.bench.LeakedActivity");
+        w.loadClass(kArrayClass, "java.lang.Object[]");
+
+        const uint32_t chunk = 1024;
+        indexed = std::min(indexed, nodes);
+        const uint32_t chunks = (indexed + chunk - 1) / chunk;
+        const uint32_t rootArray = kFirstObject;
+        const uint32_t firstChunk = rootArray + 1;
+        const uint32_t firstNode = firstChunk + chunks;
+        const uint32_t firstLeak = firstNode + nodes;
+        const uint32_t firstWeak = firstLeak + leaks * 2;
+
+        w.classDump(kObjectClass, 0, {});
+        w.classDump(kReferenceClass, kObjectClass, {{"referent", 2}, {"queue", 2}});
+        w.classDump(kWeakClass, kReferenceClass, {});
+        w.classDump(kHolderClass, kObjectClass, {}, "sItems", rootArray);
+        w.classDump(kNodeClass, kObjectClass, {{"value", 10}, {"next", 2}, {"payload", 2}});
+        w.classDump(kLeakedClass, kObjectClass, {{"mDestroyed", 4}});
+        w.classDump(kArrayClass, kObjectClass, {});
+        w.root(0x05, kHolderClass);
+
+        std::vector<uint32_t> ids;
+        for (uint32_t c = 0; c < chunks; ++c) ids.push_back(firstChunk + c);
+        w.objectArray(rootArray, kArrayClass, ids);
+        for (uint32_t c = 0; c < chunks; ++c) {
+            ids.clear();
+            for (uint32_t i = c * chunk; i < std::min(indexed, (c + 1) * chunk); ++i) ids.push_back(firstNode + i);
+            w.objectArray(firstChunk + c, kArrayClass, ids);
+        }
+        // Node.next组成链，最后leaks个节点的payload强引用Leaked
+        std::string values;
+        for (uint32_t i = 0; i < nodes; ++i) {
+            values.clear();
+            HprofWriter::u4(values, i);
+            HprofWriter::u4(values, i + 1 < nodes ? firstNode + i + 1 : 0);
+            uint32_t tail = nodes - i;
+            HprofWriter::u4(values, tail <= leaks ? firstLeak + tail - 1 : 0);
+            w.instance(firstNode + i, kNodeClass, values);
+        }
+        for (uint32_t i = 0; i < leaks * 2; ++i) {
+            w.instance(firstLeak + i, kLeakedClass, std::string(1, '\1'));
+        }
+        // 后一半Leaked只被弱引用持有
+        for (uint32_t i = 0; i < leaks; ++i) {
+            values.clear();
+            HprofWriter::u4(values, firstLeak + leaks + i);
+            HprofWriter::u4(values, 0);
+            w.instance(firstWeak + i, kWeakClass, values);
+            w.root(0x8d, firstWeak + i);
+        }
+        w.finish();
+        long size = ftell(out);
+        fclose(out);
+        return size > 0 ? (size_t) size : 0;
+    }
+
+}
+
+#endif //NATIVE_BENCH_HPROF_FIXTURE_H
@@ -0,0 +1,490 @@
+/**
+ * native模块主机基准测试
+ *
+ * 用法：native_bench [--quick] [--iterations N] [--json out.json]
+ *  - crash_report_write : 触发信号 -> 崩溃报告写完、进程退出的端到端耗时
+ *  - unwind_depth_N     : 不同调用深度下进程内_Unwind_Backtrace耗时、回溯帧数与符号化耗时
+ *  - dump_memory        : HprofDump::dump_memory 吞吐
+ *  - hprof_index / hprof_leak_trace : HprofLeakTrace 建索引与最短路径查询吞吐
+ *  - malloc_free / guarded_malloc_free : 采样保护分配器相对libc的额外开销
+ *  - handler_init       : CrashHandler::Init在调用线程上的耗时，后台初始化耗时作为附加指标
+ *  - thread_create / thread_create_hooked : pthread_create hook（挂备用栈）对线程创建的影响
+ *  - package_pack / package_pack_stored / package_verify : 崩溃日志打包（压缩 / 原样零拷贝）与逐块校验吞吐
+ *  - event_bus_latency / event_bus_mpsc : 单条投递到分发完成的延迟；4线程打满队列时的分发吞吐、每批条数与丢弃数
+ */
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <cstring>
+#include <string>
+#include <dlfcn.h>
+#include <unwind.h>
+#include "bench_util.h"
+#include "hprof_fixture.h"
+#include "native_crash_handler.h"
+#include "core/include/hprof_dump.h"
+#include "core/include/hprof_leak_trace.h"
+#include "guarded_allocator.h"
+#include "signal_stack_pool.h"
+#include "crash_package.h"
+#include "event_bus.h"
+#include <atomic>
+#include <thread>
+
+struct Options {
+    bool quick = false;
+    int iterations = 20;
+    const char *json = nullptr;
+};
+
+static void InstallCrashHandler(const std::string &dir) {
+    CrashHandler::Init(dir);
+}
+
+struct UnwindState {
+    void **current;
+    void **end;
+};
+
+// 与CrashHandler::DumpStackTrace相同的回调
+static _Unwind_Reason_Code CollectFrame(struct _Unwind_Context *ctx, void *arg) {
+    auto *state = static_cast<UnwindState *>(arg);
+    void *pc = reinterpret_cast<void *>(_Unwind_GetIP(ctx));
+    if (pc && state->current < state->end) {
+        *state->current++ = pc;
+    }
+    return pc ? _URC_NO_REASON : _URC_END_OF_STACK;
+}
+
+__attribute__((noinline)) static void Recurse(int depth, const std::function<void()> &body) {
+    if (depth <= 0) {
+        body();
+        return;
+    }
+    Recurse(depth - 1, body);
+    // 防止尾调用优化把递归折叠掉
+    asm volatile("" ::: "memory");
+}
+
+static bench::Result BenchCrashReport(const Options &opt) {
+    bench::Result result{"crash_report_write"};
+    double reportBytes = 0;
+    for (int i = 0; i < opt.iterations; ++i) {
+        std::string dir = bench::MakeTempDir("crash_bench_");
+        bench::ChildResult child = bench::RunChild([&dir](const std::function<void()> &mark) {
+            InstallCrashHandler(dir);
+            mark();
+            raise(SIGSEGV);
+        });
+        if (!child.timedOut && child.elapsedNs) {
+            result.samples.push_back(child.elapsedNs);
+        }
+        reportBytes += (double) bench::ReadCrashReport(dir).size();
+        bench::RemoveTree(dir);
+    }
+    result.metric("report_bytes", result.samples.empty() ? 0 : reportBytes / opt.iterations);
+    return result;
+}
+
+/**
+ * 在进程内、指定调用深度下计时：样本为_Unwind_Backtrace本身，
+ * 符号化（dladdr + 格式化写入/dev/null，即DumpStackTrace的其余部分）作为附加指标
+ */
+static bench::Result BenchUnwind(const Options &opt, int depth) {
+    bench::Result result{"unwind_depth_" + std::to_string(depth)};
+    static void *frames[1024];
+    size_t captured = 0;
+    uint64_t symbolizeNs = 0;
+    int devNull = open("/dev/null", O_WRONLY);
+    Recurse(depth, [&]() {
+        for (int i = 0; i < opt.iterations; ++i) {
+            UnwindState state{frames, frames + 1024};
+            uint64_t start = bench::NowNs();
+            _Unwind_Backtrace(CollectFrame, &state);
+            result.samples.push_back(bench::NowNs() - start);
+            captured = (size_t) (state.current - frames);
+
+            start = bench::NowNs();
+            for (size_t f = 0; f < captured; ++f) {
+                Dl_info info{};
+                if (dladdr(frames[f], &info)) {
+                    dprintf(devNull, "#%02zu pc %08" PRIxPTR " %s (%s+%#" PRIxPTR ")\n", f,
+                            (uintptr_t) frames[f] - (uintptr_t) info.dli_fbase, info.dli_fname,
+                            info.dli_sname ?: "??", (uintptr_t) frames[f] - (uintptr_t) info.dli_saddr);
+                }
+            }
+            symbolizeNs += bench::NowNs() - start;
+        }
+    });
+    close(devNull);
+    result.metric("requested_depth", depth);
+    result.metric("frames_captured", (double) captured);
+    result.metric("symbolize_mean_ns", (double) symbolizeNs / opt.iterations);
+    return result;
+}
+
+static bench::Result BenchDumpMemory(const Options &opt) {
+    bench::Result result{"dump_memory"};
+    std::string dir = bench::MakeTempDir("dump_bench_");
+    std::string file = dir + "/memory.dump";
+    double bytes = 0;
+    int iterations = opt.quick ? 1 : std::max(1, opt.iterations / 4);
+    for (int i = 0; i < iterations; ++i) {
+        bench::ChildResult child = bench::RunChild([&file](const std::function<void()> &mark) {
+            // dump_memory对不可读段会perror，避免刷屏
+            int devNull = open("/dev/null", O_WRONLY);
+            dup2(devNull, STDERR_FILENO);
+            mark();
+            HprofDump::dump_memory(file.c_str());
+            _exit(0);
+        }, 60000);
+        struct stat st{};
+        if (!child.timedOut && child.elapsedNs && stat(file.c_str(), &st) == 0) {
+            result.samples.push_back(child.elapsedNs);
+            bytes += (double) st.st_size;
+        }
+        unlink(file.c_str());
+    }
+    bench::RemoveTree(dir);
+    if (!result.samples.empty()) {
+        uint64_t total = 0;
+        for (uint64_t s: result.samples) total += s;
+        result.metric("bytes", bytes / (double) result.samples.size());
+        result.metric("throughput_mb_s", bytes / 1048576.0 / ((double) total / 1e9));
+    }
+    return result;
+}
+
+static void BenchHprof(const Options &opt, bench::Reporter &reporter) {
+    const uint32_t nodes = opt.quick ? 100000 : 4000000;
+    const uint32_t leaks = 16;
+    std::string dir = bench::MakeTempDir("hprof_bench_");
+    std::string path = dir + "/bench.hprof";
+    size_t size = bench::GenerateHprof(path, nodes, leaks);
+
+    bench::Result index{"hprof_index"};
+    bench::Result query{"hprof_leak_trace"};
+    size_t found = 0;
+    int iterations = opt.quick ? 1 : std::max(1, opt.iterations / 4);
+    for (int i = 0; i < iterations; ++i) {
+        HprofLeakTrace trace;
+        uint64_t start = bench::NowNs();
+        if (!trace.open(path.c_str())) {
+            fprintf(stderr, "hprof_index: open failed\n");
+            break;
+        }
+        index.samples.push_back(bench::NowNs() - start);
+
+        start = bench::NowNs();
+        found = trace.findPathsByClass("com.bench.LeakedActivity").size();
+        query.samples.push_back(bench::NowNs() - start);
+    }
+    bench::RemoveTree(dir);
+
+    auto mbPerSecond = [size](const bench::Result &r) {
+        uint64_t total = 0;
+        for (uint64_t s: r.samples) total += s;
+        return total ? (double) size * (double) r.samples.size() / 1048576.0 / ((double) total / 1e9) : 0;
+    };
+    index.metric("file_bytes", (double) size);
+    index.metric("objects", nodes + leaks * 3 + (nodes + 1023) / 1024 + 1);
+    index.metric("throughput_mb_s", mbPerSecond(index));
+    query.metric("traces_found", (double) found);
+    query.metric("traces_expected", leaks);
+    query.metric("throughput_mb_s", mbPerSecond(query));
+    reporter.add(index);
+    reporter.add(query);
+}
+
+/**
+ * 每个样本为一批malloc/free的耗时；guarded在子进程中开启默认采样率，不影响其他基准
+ */
+static void BenchGuardedAllocator(const Options &opt, bench::Reporter &reporter) {
+    const int batch = opt.quick ? 10000 : 200000;
+    auto run = [&opt, batch](bool guarded) {
+        bench::Result result{guarded ? "guarded_malloc_free" : "malloc_free"};
+        int pipeFd[2];
+        if (pipe(pipeFd) != 0) {
+            return result;
+        }
+        bench::RunChild([&](const std::function<void()> &) {
+            if (guarded) {
+                apm::GuardedAllocator::Enable(apm::GuardedAllocator::kDefaultSampleRate,
+                                              apm::GuardedAllocator::kDefaultSlots);
+            }
+            std::vector<void *> ptrs((size_t) batch);
+            for (int i = 0; i < opt.iterations; ++i) {
+                uint64_t start = bench::NowNs();
+                for (int j = 0; j < batch; ++j) {
+                    ptrs[j] = apm::GuardedAllocator::Malloc((size_t) (16 + j % 512));
+                }
+                for (int j = 0; j < batch; ++j) {
+                    apm::GuardedAllocator::Free(ptrs[j]);
+                }
+                uint64_t elapsed = bench::NowNs() - start;
+                write(pipeFd[1], &elapsed, sizeof(elapsed));
+            }
+            _exit(0);
+        }, 60000);
+        close(pipeFd[1]);
+        uint64_t elapsed;
+        while (read(pipeFd[0], &elapsed, sizeof(elapsed)) == (ssize_t) sizeof(elapsed)) {
+            result.samples.push_back(elapsed);
+        }
+        close(pipeFd[0]);
+        result.metric("ops_per_sample", batch);
+        return result;
+    };
+    bench::Result plain = run(false);
+    bench::Result guarded = run(true);
+    auto mean = [](const bench::Result &r) {
+        uint64_t total = 0;
+        for (uint64_t s: r.samples) total += s;
+        return r.samples.empty() ? 0.0 : (double) total / (double) r.samples.size();
+    };
+    if (mean(plain) > 0) {
+        guarded.metric("overhead_pct", (mean(guarded) / mean(plain) - 1.0) * 100.0);
+    }
+    reporter.add(plain);
+    reporter.add(guarded);
+}
+
+static bench::Result BenchHandlerInit(const Options &opt) {
+    bench::Result result{"handler_init"};
+    std::vector<uint64_t> deferred;
+    for (int i = 0; i < opt.iterations; ++i) {
+        std::string dir = bench::MakeTempDir("init_bench_");
+        int pipeFd[2];
+        if (pipe(pipeFd) != 0) {
+            break;
+        }
+        bench::RunChild([&dir, &pipeFd](const std::function<void()> &) {
+            InstallCrashHandler(dir);
+            uint64_t costs[2] = {CrashHandler::InitCostNs(), bench::WaitDeferredInit() ? CrashHandler::DeferredInitCostNs() : 0};
+            write(pipeFd[1], costs, sizeof(costs));
+            _exit(0);
+        });
+        close(pipeFd[1]);
+        uint64_t costs[2];
+        if (read(pipeFd[0], costs, sizeof(costs)) == (ssize_t) sizeof(costs)) {
+            result.samples.push_back(costs[0]);
+            deferred.push_back(costs[1]);
+        }
+        close(pipeFd[0]);
+        bench::RemoveTree(dir);
+    }
+    if (!deferred.empty()) {
+        uint64_t total = 0;
+        for (uint64_t d: deferred) total += d;
+        result.metric("deferred_mean_ns", (double) total / (double) deferred.size());
+    }
+    return result;
+}
+
+// 每个样本为一批线程的创建+join耗时
+static bench::Result BenchThreadCreate(const Options &opt, bool hooked) {
+    bench::Result result{hooked ? "thread_create_hooked" : "thread_create"};
+    const int batch = opt.quick ? 32 : 256;
+    std::string dir = bench::MakeTempDir("thread_bench_");
+    int pipeFd[2];
+    if (pipe(pipeFd) != 0) {
+        return result;
+    }
+    bench::RunChild([&](const std::function<void()> &) {
+        if (hooked) {
+            InstallCrashHandler(dir);
+            bench::WaitDeferredInit();
+        }
+        for (int i = 0; i < opt.iterations; ++i) {
+            uint64_t start = bench::NowNs();
+            for (int t = 0; t < batch; ++t) {
+                pthread_t thread;
+                if (pthread_create(&thread, nullptr, [](void *) -> void * { return nullptr; }, nullptr) == 0) {
+                    pthread_join(thread, nullptr);
+                }
+            }
+            uint64_t elapsed = bench::NowNs() - start;
+            write(pipeFd[1], &elapsed, sizeof(elapsed));
+        }
+        _exit(0);
+    }, 60000);
+    close(pipeFd[1]);
+    uint64_t elapsed;
+    while (read(pipeFd[0], &elapsed, sizeof(elapsed)) == (ssize_t) sizeof(elapsed)) {
+        result.samples.push_back(elapsed);
+    }
+    close(pipeFd[0]);
+    bench::RemoveTree(dir);
+    result.metric("threads_per_sample", batch);
+    return result;
+}
+
+/**
+ * 用一份真实的崩溃报告复制出一批日志，另外放同等大小的.gz文件走原样存储路径
+ */
+static void BenchPackage(const Options &opt, bench::Reporter &reporter) {
+    const int count = opt.quick ? 10 : 100;
+    std::string dir = bench::MakeTempDir("package_bench_");
+    bench::RunChild([&dir](const std::function<void()> &) {
+        InstallCrashHandler(dir);
+        raise(SIGSEGV);
+    });
+    std::string report = bench::ReadCrashReport(dir);
+    std::vector<std::string> logs;
+    std::vector<std::string> stored;
+    uint64_t inputBytes = 0;
+    for (int i = 0; i < count; ++i) {
+        for (int gz = 0; gz < 2; ++gz) {
+            std::string path = dir + "/report-" + std::to_string(i) + (gz ? ".log.gz" : ".log");
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0640);
+            if (fd == -1) continue;
+            write(fd, report.data(), report.size());
+            close(fd);
+            (gz ? stored : logs).push_back(path);
+        }
+        inputBytes += report.size();
+    }
+    std::string archive = dir + "/batch.acpk";
+    auto run = [&](const char *name, const std::vector<std::string> &files) {
+        bench::Result result{name};
+        int64_t size = 0;
+        for (int i = 0; i < opt.iterations; ++i) {
+            uint64_t start = bench::NowNs();
+            size = CrashPackage::Pack(archive, files);
+            result.samples.push_back(bench::NowNs() - start);
+        }
+        uint64_t total = 0;
+        for (uint64_t t: result.samples) total += t;
+        result.metric("input_bytes", (double) inputBytes);
+        result.metric("archive_bytes", (double) size);
+        result.metric("throughput_mb_s", (double) inputBytes / 1048576.0 / ((double) total / 1e9 / (double) result.samples.size()));
+        reporter.add(result);
+    };
+    run("package_pack_stored", stored);
+    run("package_pack", logs);
+    bench::Result verify{"package_verify"};
+    bool ok = true;
+    for (int i = 0; ok && i < opt.iterations; ++i) {
+        uint64_t start = bench::NowNs();
+        ok = CrashPackage::Extract(archive, std::string());
+        verify.samples.push_back(bench::NowNs() - start);
+    }
+    verify.metric("ok", ok ? 1 : 0);
+    reporter.add(verify);
+    bench::RemoveTree(dir);
+}
+
+static std::atomic<uint64_t> g_busEvents(0);
+static std::atomic<uint64_t> g_busBatches(0);
+
+static void CountingSink(const Event *, size_t count) {
+    g_busEvents.fetch_add(count, std::memory_order_relaxed);
+    g_busBatches.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void BenchEventBus(const Options &opt, bench::Reporter &reporter) {
+    const int producers = 4;
+    const int perProducer = opt.quick ? 5000 : 50000;
+    int pipeFd[2];
+    if (pipe(pipeFd) != 0) {
+        return;
+    }
+    // 子进程依次写出：latency样本... | 0 | mpsc样本... | 0 | 投递数 | 每批平均条数*1000 | 丢弃数
+    bench::RunChild([&](const std::function<void()> &) {
+        EventBus::SetSink(CountingSink);
+        EventBus::Start(nullptr);
+        uint64_t zero = 0;
+        for (int i = 0; i < opt.iterations; ++i) {
+            uint64_t start = bench::NowNs();
+            EventBus::Post(EventType::MemoryThreshold, i, "latency");
+            EventBus::Flush(1000);
+            uint64_t elapsed = bench::NowNs() - start;
+            write(pipeFd[1], &elapsed, sizeof(elapsed));
+        }
+        write(pipeFd[1], &zero, sizeof(zero));
+        uint64_t batchesBefore = g_busBatches.load();
+        uint64_t eventsBefore = g_busEvents.load();
+        uint64_t posted = 0;
+        for (int i = 0; i < opt.iterations; ++i) {
+            std::atomic<uint64_t> ok(0);
+            uint64_t start = bench::NowNs();
+            std::vector<std::thread> workers;
+            for (int p = 0; p < producers; ++p) {
+                workers.emplace_back([&ok, perProducer]() {
+                    for (int j = 0; j < perProducer; ++j) {
+                        if (EventBus::Post(EventType::MemoryThreshold, j, "mpsc")) ok++;
+                    }
+                });
+            }
+            for (auto &w: workers) w.join();
+            EventBus::Flush(5000);
+            uint64_t elapsed = bench::NowNs() - start;
+            write(pipeFd[1], &elapsed, sizeof(elapsed));
+            posted += ok.load();
+        }
+        write(pipeFd[1], &zero, sizeof(zero));
+        uint64_t batches = g_busBatches.load() - batchesBefore;
+        uint64_t meanBatch = batches ? (g_busEvents.load() - eventsBefore) * 1000 / batches : 0;
+        uint64_t dropped = EventBus::Dropped();
+        write(pipeFd[1], &posted, sizeof(posted));
+        write(pipeFd[1], &meanBatch, sizeof(meanBatch));
+        write(pipeFd[1], &dropped, sizeof(dropped));
+        _exit(0);
+    }, 120000);
+    close(pipeFd[1]);
+    bench::Result latency{"event_bus_latency"};
+    bench::Result mpsc{"event_bus_mpsc"};
+    uint64_t value;
+    while (read(pipeFd[0], &value, sizeof(value)) == (ssize_t) sizeof(value) && value) {
+        latency.samples.push_back(value);
+    }
+    while (read(pipeFd[0], &value, sizeof(value)) == (ssize_t) sizeof(value) && value) {
+        mpsc.samples.push_back(value);
+    }
+    uint64_t tail[3] = {};
+    for (uint64_t &t: tail) {
+        if (read(pipeFd[0], &t, sizeof(t)) != (ssize_t) sizeof(t)) break;
+    }
+    close(pipeFd[0]);
+    uint64_t total = 0;
+    for (uint64_t t: mpsc.samples) total += t;
+    mpsc.metric("posts_per_sample", producers * perProducer);
+    mpsc.metric("delivered_per_sec", total ? (double) tail[0] / ((double) total / 1e9) : 0);
+    mpsc.metric("mean_batch", (double) tail[1] / 1000.0);
+    mpsc.metric("dropped", (double) tail[2]);
+    reporter.add(latency);
+    reporter.add(mpsc);
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            opt.quick = true;
+            opt.iterations = 3;
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            opt.iterations = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            opt.json = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--iterations N] [--json out.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bench::Reporter reporter;
+    reporter.add(BenchCrashReport(opt));
+    for (int depth: {8, 32, 64, 128, 256}) {
+        reporter.add(BenchUnwind(opt, depth));
+    }
+    reporter.add(BenchDumpMemory(opt));
+    BenchHprof(opt, reporter);
+    BenchGuardedAllocator(opt, reporter);
+    reporter.add(BenchHandlerInit(opt));
+    reporter.add(BenchThreadCreate(opt, false));
+    reporter.add(BenchThreadCreate(opt, true));
+    BenchPackage(opt, reporter);
+    BenchEventBus(opt, reporter);
+    return reporter.write(opt.json) ? 0 : 1;
+}
@@ -0,0 +1,595 @@
+/**
+ * 崩溃处理压力测试（ctest运行）
+ *  - repeated_signals    : 轮流触发SIGSEGV/SIGABRT/SIGBUS/SIGFPE/SIGILL，报告完整且进程按原信号退出
+ *  - concurrent_signals  : 多个线程同时崩溃，进程不能卡死，且最多生成一份报告
+ *  - storage_quota       : 同一目录反复崩溃后日志数量不超过配额
+ *  - guarded_allocator   : UAF/越界/double free/非法realloc写入报告，并带有分配、释放栈；经GOT hook的普通malloc
+ *                          （包括Enable之后dlopen的so）同样被采样，malloc_usable_size/posix_memalign/getline对采样内存正确
+ *  - thread_stack_overflow : Init之后创建的线程栈溢出，备用栈上仍能写出完整报告；线程退出后栈被复用
+ *  - hprof_leak_trace    : 最短引用链与引用名逐项一致，只被弱引用持有的实例不出现；截断/损坏的heap dump segment被拒绝且不越界读
+ *  - crash_package       : 打包/解包往返一致，索引偏移指向块头，跳过的文件被报告，损坏的块能被发现
+ *  - event_bus           : 多线程+信号处理函数并发投递，不丢（除计数的丢弃）、单生产者内有序；崩溃事件带实际报告路径
+ */
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <malloc.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_util.h"
+#include "hprof_fixture.h"
+#include "native_crash_handler.h"
+#include "guarded_allocator.h"
+#include "signal_stack_pool.h"
+#include "crash_package.h"
+#include "event_bus.h"
+#include "core/include/hprof_leak_trace.h"
+
+static int g_failures = 0;
+
+#define EXPECT(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "FAILED %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+        g_failures++; \
+    } \
+} while (0)
+
+static int CountReports(const std::string &dir) {
+    int count = 0;
+    DIR *d = opendir(dir.c_str());
+    if (!d) return 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != nullptr) {
+        if (strncmp(e->d_name, "crash-", 6) == 0) count++;
+    }
+    closedir(d);
+    return count;
+}
+
+static void RepeatedSignals(int rounds) {
+    const int signals[] = {SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL};
+    for (int i = 0; i < rounds; ++i) {
+        int sig = signals[i % 5];
+        std::string dir = bench::MakeTempDir("stress_repeat_");
+        bench::ChildResult child = bench::RunChild([&dir, sig](const std::function<void()> &) {
+            CrashHandler::Init(dir);
+            raise(sig);
+        });
+        std::string report = bench::ReadCrashReport(dir);
+        char expected[32];
+        snprintf(expected, sizeof(expected), "Signal: %d ", sig);
+        EXPECT(!child.timedOut, "round %d signal %d hung", i, sig);
+        EXPECT(WIFSIGNALED(child.status) && WTERMSIG(child.status) == sig,
+               "round %d signal %d: status 0x%x", i, sig, child.status);
+        EXPECT(report.find(expected) != std::string::npos, "round %d: missing '%s'", i, expected);
+        EXPECT(report.find("*** End of Crash Report ***") != std::string::npos,
+               "round %d signal %d: truncated report", i, sig);
+        bench::RemoveTree(dir);
+    }
+}
+
+static void ConcurrentSignals(int rounds, int threads) {
+    for (int i = 0; i < rounds; ++i) {
+        std::string dir = bench::MakeTempDir("stress_concurrent_");
+        bench::ChildResult child = bench::RunChild([&dir, threads](const std::function<void()> &) {
+            CrashHandler::Init(dir);
+            std::atomic_int ready(0);
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&ready, threads]() {
+                    ready++;
+                    while (ready.load() < threads) {
+                    }
+                    raise(SIGSEGV);
+                });
+            }
+            for (auto &w: workers) w.join();
+        });
+        EXPECT(!child.timedOut, "round %d: crashing %d threads hung", i, threads);
+        EXPECT(WIFSIGNALED(child.status) || (WIFEXITED(child.status) && WEXITSTATUS(child.status) != 0),
+               "round %d: process survived, status 0x%x", i, child.status);
+        EXPECT(CountReports(dir) <= 1, "round %d: %d reports", i, CountReports(dir));
+        std::string report = bench::ReadCrashReport(dir);
+        EXPECT(report.empty() || report.rfind("*** Native Crash Report ***", 0) == 0,
+               "round %d: corrupted report header", i);
+        bench::RemoveTree(dir);
+    }
+}
+
+static void StorageQuota(int rounds, uint32_t maxCount) {
+    std::string dir = bench::MakeTempDir("stress_quota_");
+    // 没有manifest时的积压日志（升级前遗留），首次Init扫描后应被淘汰
+    for (uint32_t i = 0; i < maxCount * 4; ++i) {
+        std::string old = dir + "/crash-old-" + std::to_string(i) + ".log";
+        int fd = open(old.c_str(), O_CREAT | O_WRONLY, 0640);
+        if (fd != -1) close(fd);
+    }
+    for (int i = 0; i < rounds; ++i) {
+        bench::RunChild([&dir, maxCount](const std::function<void()> &) {
+            CrashHandler::Init(dir);
+            CrashStorage::SetQuota(CrashStorage::kDefaultMaxBytes, maxCount);
+            raise(SIGSEGV);
+        });
+    }
+    // manifest在后台加载，Init返回后立即List也要拿到已有日志
+    bench::ChildResult listed0 = bench::RunChild([&dir](const std::function<void()> &) {
+        CrashHandler::Init(dir);
+        _exit((int) std::min<size_t>(CrashStorage::List().size(), 100));
+    });
+    EXPECT(WIFEXITED(listed0.status) && WEXITSTATUS(listed0.status) > 0,
+           "List() right after Init returned %d logs", WEXITSTATUS(listed0.status));
+    // 分发线程已在运行时再次Init，延迟加载仍要执行，List不能等到超时兜底
+    bench::ChildResult reinit = bench::RunChild([&dir](const std::function<void()> &) {
+        CrashHandler::Init(dir);
+        CrashStorage::List();
+        CrashHandler::Init(dir);
+        _exit((int) std::min<size_t>(CrashStorage::List().size(), 100));
+    }, (CrashStorage::kReadyTimeoutSec - 2) * 1000);
+    EXPECT(!reinit.timedOut && WIFEXITED(reinit.status) && WEXITSTATUS(reinit.status) > 0,
+           "List() after second Init: status 0x%x", reinit.status);
+    CrashStorage::Init(dir);
+    CrashStorage::SetQuota(CrashStorage::kDefaultMaxBytes, maxCount);
+    size_t listed = CrashStorage::List().size();
+    EXPECT(listed <= maxCount, "%zu logs listed, quota %u", listed, maxCount);
+    EXPECT(CountReports(dir) <= (int) maxCount, "%d logs on disk, quota %u", CountReports(dir), maxCount);
+
+    // manifest之外写下的报告（例如追加失败）：下次Init补进来，RemoveAll也要删掉
+    usleep(30 * 1000);  // 文件时间戳精度较粗时，保证目录的mtime晚于manifest
+    std::string orphan = dir + "/crash-orphan.log";
+    int orphanFd = open(orphan.c_str(), O_CREAT | O_WRONLY, 0640);
+    if (orphanFd != -1) close(orphanFd);
+    CrashStorage::Init(dir);
+    std::vector<std::string> paths = CrashStorage::List();
+    EXPECT(std::find(paths.begin(), paths.end(), orphan) != paths.end(), "unrecorded report not listed after Init");
+    CrashStorage::RemoveAll();
+    EXPECT(CountReports(dir) == 0, "%d logs left after RemoveAll", CountReports(dir));
+    bench::RemoveTree(dir);
+}
+
+// 采样率为1，保证每次分配都进保护池
+static void GuardedAllocatorErrors() {
+    struct Case {
+        const char *error;
+        bool hooked;        // 通过GOT hook后的普通malloc/free触发
+        bool freed;
+        void (*trigger)();
+    };
+    const Case cases[] = {
+            {"use-after-free", false, true, []() {
+                auto *p = static_cast<volatile char *>(apm::GuardedAllocator::Malloc(32));
+                apm::GuardedAllocator::Free((void *) p);
+                p[0] = 1;
+            }},
+            {"buffer-overflow", false, false, []() {
+                auto *p = static_cast<volatile char *>(apm::GuardedAllocator::Malloc(32));
+                p[4096] = 1;
+            }},
+            {"double-free", false, true, []() {
+                void *p = apm::GuardedAllocator::Malloc(32);
+                apm::GuardedAllocator::Free(p);
+                apm::GuardedAllocator::Free(p);
+            }},
+            {"invalid-free", false, false, []() {
+                // 第一个槽位左侧的保护页：realloc也要按保护页校验
+                auto p = reinterpret_cast<uintptr_t>(apm::GuardedAllocator::Malloc(32));
+                uintptr_t guard = (p & ~(uintptr_t) (sysconf(_SC_PAGESIZE) - 1)) - 16;
+                apm::GuardedAllocator::Realloc(reinterpret_cast<void *>(guard), 64);
+            }},
+            {"use-after-free", true, true, []() {
+                // 经函数指针调用，避免编译器按malloc语义优化掉
+                void *(*volatile allocate)(size_t) = malloc;
+                void (*volatile release)(void *) = free;
+                auto *p = static_cast<volatile char *>(allocate(32));
+                release((void *) p);
+                p[0] = 1;
+            }},
+            {"double-free", true, true, []() {
+                void *(*volatile reallocate)(void *, size_t) = realloc;
+                void (*volatile release)(void *) = free;
+                void *p = reallocate(nullptr, 32);
+                release(p);
+                release(p);
+            }},
+    };
+    for (const Case &c: cases) {
+        std::string dir = bench::MakeTempDir("stress_gwp_");
+        bench::ChildResult child = bench::RunChild([&dir, &c](const std::function<void()> &) {
+            CrashHandler::Init(dir);
+            // 只接管本测试程序自己的分配（相当于应用的so）
+            if (!apm::GuardedAllocator::Enable(1, 8, c.hooked ? "signal_stress" : "/nonexistent/")) {
+                _exit(3);
+            }
+            c.trigger();
+        });
+        std::string report = bench::ReadCrashReport(dir);
+        const char *mode = c.hooked ? " (hooked)" : "";
+        EXPECT(!child.timedOut && WIFSIGNALED(child.status), "%s%s: status 0x%x", c.error, mode, child.status);
+        EXPECT(report.find(std::string("Error: ") + c.error) != std::string::npos, "%s%s: not reported", c.error, mode);
+        EXPECT(report.find("Allocated by thread") != std::string::npos, "%s%s: no allocation stack", c.error, mode);
+        if (c.freed) {
+            EXPECT(report.find("Deallocated by thread") != std::string::npos, "%s%s: no free stack", c.error, mode);
+        }
+        bench::RemoveTree(dir);
+    }
+
+    // Enable之后加载的so在dlopen返回时补上hook
+    std::string probeDir = bench::MakeTempDir("stress_gwp_");
+    bench::ChildResult probe = bench::RunChild([&probeDir](const std::function<void()> &) {
+        CrashHandler::Init(probeDir);
+        if (!apm::GuardedAllocator::Enable(1, 8, "libgwp_probe")) {
+            _exit(3);
+        }
+        void *handle = dlopen(GWP_PROBE_PATH, RTLD_NOW);
+        auto trigger = handle ? reinterpret_cast<void (*)()>(dlsym(handle, "gwp_probe_use_after_free")) : nullptr;
+        if (!trigger) {
+            _exit(4);
+        }
+        trigger();
+        _exit(0);
+    });
+    EXPECT(!probe.timedOut && WIFSIGNALED(probe.status), "dlopen after Enable: status 0x%x", probe.status);
+    EXPECT(bench::ReadCrashReport(probeDir).find("Error: use-after-free") != std::string::npos,
+           "dlopen after Enable: not reported");
+    bench::RemoveTree(probeDir);
+
+    // 全部分配都采样时，其他线程释放、libc查询/realloc本程序分配的内存，进程照常运行
+    bench::ChildResult child = bench::RunChild([](const std::function<void()> &) {
+        if (!apm::GuardedAllocator::Enable(1, 16, "signal_stress")) {
+            _exit(3);
+        }
+        void *(*volatile allocate)(size_t) = malloc;
+        size_t (*volatile usableSize)(void *) = malloc_usable_size;
+        int (*volatile allocateAligned)(void **, size_t, size_t) = posix_memalign;
+        ssize_t (*volatile readLine)(char **, size_t *, FILE *) = getline;
+        void *sized = allocate(48);
+        if (usableSize(sized) != 48) {
+            _exit(5);
+        }
+        free(sized);
+        void *aligned = nullptr;
+        if (allocateAligned(&aligned, 64, 100) != 0 || reinterpret_cast<uintptr_t>(aligned) % 64 != 0) {
+            _exit(6);
+        }
+        free(aligned);
+        // getline会realloc传入的缓冲区
+        char text[] = "a line longer than the four byte buffer\n";
+        FILE *stream = fmemopen(text, sizeof(text) - 1, "r");
+        auto *line = static_cast<char *>(allocate(4));
+        size_t capacity = 4;
+        if (!stream || readLine(&line, &capacity, stream) != (ssize_t) sizeof(text) - 1 || strcmp(line, text) != 0) {
+            _exit(7);
+        }
+        free(line);
+        fclose(stream);
+        for (int i = 0; i < 2000; ++i) {
+            auto *p = static_cast<char *>(allocate(48));
+            snprintf(p, 48, "item-%d", i);
+            std::string copy(p);
+            std::vector<std::string> items(4, copy);
+            std::thread([p]() { free(p); }).join();
+            if (items.back() != copy) {
+                _exit(4);
+            }
+        }
+        _exit(0);
+    }, 30000);
+    EXPECT(!child.timedOut && WIFEXITED(child.status) && WEXITSTATUS(child.status) == 0,
+           "hooked workload: status 0x%x", child.status);
+}
+
+__attribute__((noinline)) static int Overflow(int depth) {
+    volatile char frame[1024];
+    frame[0] = (char) depth;
+    asm volatile("" ::: "memory");
+    return Overflow(depth + 1) + frame[0];
+}
+
+static void ThreadStackOverflow(int rounds) {
+    for (int i = 0; i < rounds; ++i) {
+        std::string dir = bench::MakeTempDir("stress_overflow_");
+        bench::ChildResult child = bench::RunChild([&dir](const std::function<void()> &) {
+            CrashHandler::Init(dir);
+            if (!bench::WaitDeferredInit()) {
+                _exit(2);
+            }
+            // 先跑几批短命线程，栈应被归还复用而不是一直增长
+            for (int batch = 0; batch < 4; ++batch) {
+                std::vector<std::thread> workers;
+                for (int t = 0; t < 16; ++t) {
+                    workers.emplace_back([]() {});
+                }
+                for (auto &w: workers) w.join();
+            }
+            if (SignalStackPool::InUse() > 2) {
+                _exit(3);
+            }
+            std::thread([]() { Overflow(0); }).join();
+        }, 30000);
+        std::string report = bench::ReadCrashReport(dir);
+        EXPECT(!child.timedOut, "round %d hung", i);
+        EXPECT(!WIFEXITED(child.status), "round %d: exit code %d", i, WEXITSTATUS(child.status));
+        EXPECT(WIFSIGNALED(child.status) && WTERMSIG(child.status) == SIGSEGV,
+               "round %d: status 0x%x", i, child.status);
+        EXPECT(report.find("*** End of Crash Report ***") != std::string::npos,
+               "round %d: no complete report for overflowing thread", i);
+        bench::RemoveTree(dir);
+    }
+}
+
+static std::string ReadFile(const std::string &path) {
+    std::string content;
+    int fd = open(path.c_str(), O_RDONLY);
+    char buf[4096];
+    ssize_t n;
+    while (fd != -1 && (n = read(fd, buf, sizeof(buf))) > 0) {
+        content.append(buf, (size_t) n);
+    }
+    if (fd != -1) close(fd);
+    return content;
+}
+
+static void WriteFile(const std::string &path, const std::string &content) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0640);
+    if (fd != -1) {
+        write(fd, content.data(), content.size());
+        close(fd);
+    }
+}
+
+static std::string ChainOf(const LeakTrace &trace) {
+    std::string chain;
+    for (const LeakTraceElement &e: trace.elements) {
+        chain += e.className;
+        if (!e.referenceName.empty()) {
+            chain += "." + e.referenceName + " -> ";
+        }
+    }
+    return chain;
+}
+
+static void HprofLeakTraces() {
+    const uint32_t nodes = 64, leaks = 4;
+    std::string dir = bench::MakeTempDir("stress_hprof_");
+    // 每个Leaked只能从Object[]里的第一个Node沿next走到；Object[]直接引用全部Node时最短链不经过next
+    for (uint32_t indexed: {1u, nodes}) {
+        std::string path = dir + "/leak.hprof";
+        bench::GenerateHprof(path, nodes, leaks, indexed);
+        HprofLeakTrace trace;
+        EXPECT(trace.open(path.c_str()), "indexed %u: open failed", indexed);
+        std::vector<LeakTrace> traces = trace.findPathsByClass("com.bench.LeakedActivity");
+        EXPECT(traces.size() == leaks, "indexed %u: %zu traces", indexed, traces.size());
+        const uint32_t firstLeak = bench::kFirstObject + 2 + (indexed - 1) / 1024 + nodes;
+        for (const LeakTrace &t: traces) {
+            // 后一半Leaked只被弱引用持有
+            EXPECT(t.targetId >= firstLeak && t.targetId < firstLeak + leaks,
+                   "indexed %u: weakly held 0x%llx reported", indexed, (unsigned long long) t.targetId);
+            if (t.targetId < firstLeak || t.targetId >= firstLeak + leaks) {
+                continue;
+            }
+            // 第j个Leaked挂在倒数第j+1个Node上
+            uint32_t node = nodes - 1 - (uint32_t) (t.targetId - firstLeak);
+            std::string expected = "class com.bench.Holder.sItems -> java.lang.Object[].[0] -> ";
+            if (indexed == 1) {
+                expected += "java.lang.Object[].[0] -> ";
+                for (uint32_t i = 0; i < node; ++i) expected += "com.bench.Node.next -> ";
+            } else {
+                expected += "java.lang.Object[].[" + std::to_string(node) + "] -> ";
+            }
+            expected += "com.bench.Node.payload -> com.bench.LeakedActivity";
+            EXPECT(t.rootType == 0x05 && ChainOf(t) == expected, "indexed %u: got %s", indexed, ChainOf(t).c_str());
+        }
+    }
+
+    // 截断heap dump segment并把记录长度改成与之一致，文件末尾对齐到页，越界读会直接出错
+    std::string content = ReadFile(dir + "/leak.hprof");
+    size_t pos = strlen(content.c_str()) + 1 + 12;
+    while (pos + 9 <= content.size() && content[pos] != 0x1c) {
+        pos += 9 + ((uint32_t) (uint8_t) content[pos + 5] << 24 | (uint32_t) (uint8_t) content[pos + 6] << 16
+                    | (uint32_t) (uint8_t) content[pos + 7] << 8 | (uint8_t) content[pos + 8]);
+    }
+    EXPECT(pos + 9 <= content.size(), "no heap dump segment");
+    const size_t segment = pos + 9;
+    const size_t segmentSize = std::min(content.size(), segment + (size_t) ((uint8_t) content[pos + 5] << 24
+            | (uint8_t) content[pos + 6] << 16 | (uint8_t) content[pos + 7] << 8 | (uint8_t) content[pos + 8])) - segment;
+    std::string truncatedPath = dir + "/truncated.hprof";
+    bench::ChildResult child = bench::RunChild([&](const std::function<void()> &) {
+        const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDERR_FILENO);
+        for (size_t cut = 1; cut < segmentSize; cut += cut < 512 ? 1 : 37) {
+            uint32_t length = (uint32_t) (segmentSize - cut);
+            // 在segment前插入一个未知tag的填充记录，使文件大小是页大小的整数倍
+            size_t tail = segment + length;
+            size_t filler = (page - (tail + 9) % page) % page;
+            std::string out = content.substr(0, pos);
+            out.push_back(0x7f);
+            out.append(4, '\0');
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back((char) (filler >> shift));
+            out.append(filler, '\0');
+            out.push_back(0x1c);
+            out.append(4, '\0');
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back((char) (length >> shift));
+            out.append(content, segment, length);
+            WriteFile(truncatedPath, out);
+            HprofLeakTrace trace;
+            // 截到最后一条子记录中间一定要被拒绝，其余位置只要求不崩溃
+            if (trace.open(truncatedPath.c_str()) && cut == 1) {
+                _exit(2);
+            }
+        }
+        _exit(0);
+    }, 60000);
+    EXPECT(!child.timedOut && WIFEXITED(child.status) && WEXITSTATUS(child.status) == 0,
+           "truncated segment: status 0x%x", child.status);
+    bench::RemoveTree(dir);
+}
+
+static void CrashPackageRoundTrip() {
+    const uint32_t chunkSize = 64 * 1024;
+    std::string dir = bench::MakeTempDir("stress_package_");
+    mkdir((dir + "/in").c_str(), 0750);
+    mkdir((dir + "/out").c_str(), 0750);
+    // 可压缩的日志、跨多个块的大文件、不可压缩的.gz（原样存储+零拷贝）、空文件
+    std::vector<std::pair<std::string, std::string>> inputs;
+    std::string log;
+    for (int i = 0; i < 200; ++i) log += "7f0000" + std::to_string(i) + "-7f0010 r-xp 00000000 fd:00 123 /system/lib64/libc.so\n";
+    inputs.emplace_back("crash-1.log", log);
+    std::string big;
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < chunkSize * 3 + 17; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        big.push_back(i % 3 ? 'a' : (char) (seed >> 24));
+    }
+    inputs.emplace_back("memory.hprof.part0", big);
+    inputs.emplace_back("breadcrumbs.gz", big.substr(0, chunkSize + 100));
+    inputs.emplace_back("empty.log", std::string());
+    std::vector<std::string> files;
+    for (const auto &in: inputs) {
+        WriteFile(dir + "/in/" + in.first, in.second);
+        files.push_back(dir + "/in/" + in.first);
+    }
+    files.push_back(dir + "/in/missing.log");  // 读取失败的文件跳过
+
+    std::string archive = dir + "/batch.acpk";
+    std::vector<std::string> skipped;
+    int64_t size = CrashPackage::Pack(archive, files, chunkSize, &skipped);
+    EXPECT(size > 0 && (uint64_t) size == ReadFile(archive).size(), "pack returned %lld", (long long) size);
+    EXPECT(skipped.size() == 1 && skipped[0] == files.back(), "%zu files reported as skipped", skipped.size());
+    std::vector<CrashPackage::Entry> entries;
+    EXPECT(CrashPackage::ReadIndex(archive, entries) && entries.size() == inputs.size(),
+           "index has %zu entries", entries.size());
+    std::string content = ReadFile(archive);
+    for (const auto &e: entries) {
+        EXPECT(e.chunks == 0 || content.compare(e.offset, 4, "ACHK") == 0, "%s: offset is not a chunk", e.name.c_str());
+    }
+    EXPECT(CrashPackage::Extract(archive, dir + "/out"), "extract failed");
+    for (const auto &in: inputs) {
+        EXPECT(ReadFile(dir + "/out/" + in.first) == in.second, "%s: content mismatch", in.first.c_str());
+    }
+
+    // 改坏大文件第二个块中的一个字节
+    const CrashPackage::Entry &victim = entries[1];
+    std::string corrupted = content;
+    size_t at = victim.offset + 24 + 8;
+    while (at < content.size() && content.compare(at, 4, "ACHK") != 0) at++;
+    corrupted[at + 24 + 10] ^= 0x5a;
+    WriteFile(archive, corrupted);
+    EXPECT(!CrashPackage::Extract(archive, std::string()), "corrupted chunk not detected");
+    bench::RemoveTree(dir);
+}
+
+static std::atomic<uint64_t> g_sinkReceived(0);
+static std::atomic<uint64_t> g_signalPosted(0);
+static std::atomic<uint64_t> g_signalAttempts(0);
+static std::atomic_bool g_sinkOrdered(true);
+static int64_t g_lastSeq[8];
+static int g_sinkFd = -1;
+
+// value = 生产者 << 32 | 序号，检查每个生产者的事件按投递顺序到达
+static void OrderingSink(const Event *events, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (events[i].type == (uint32_t) EventType::MemoryThreshold) {
+            auto producer = (size_t) (events[i].value >> 32);
+            int64_t seq = events[i].value & 0xffffffff;
+            if (producer >= 8 || seq <= g_lastSeq[producer]) {
+                g_sinkOrdered.store(false);
+            } else {
+                g_lastSeq[producer] = seq;
+            }
+        }
+    }
+    g_sinkReceived.fetch_add(count);
+}
+
+static void PathSink(const Event *events, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (events[i].type == (uint32_t) EventType::Crash) {
+            write(g_sinkFd, events[i].detail, strlen(events[i].detail));
+        }
+    }
+}
+
+static void EventBusDelivery(int rounds) {
+    const int producers = 4;
+    const int perProducer = 20000;
+    bench::ChildResult child = bench::RunChild([&](const std::function<void()> &) {
+        for (int64_t &seq: g_lastSeq) seq = -1;
+        EventBus::SetSink(OrderingSink);
+        EventBus::Start(nullptr);
+        struct sigaction sa{};
+        sa.sa_handler = [](int) {
+            g_signalAttempts++;
+            if (EventBus::Post(EventType::Anr, 0, "SIGUSR1")) g_signalPosted++;
+        };
+        sigaction(SIGUSR1, &sa, nullptr);
+        std::atomic<uint64_t> posted(0);
+        std::vector<std::thread> workers;
+        for (int p = 0; p < producers; ++p) {
+            workers.emplace_back([&posted, p]() {
+                for (int i = 0; i < perProducer; ++i) {
+                    if (EventBus::Post(EventType::MemoryThreshold, ((int64_t) p << 32) | i, "producer")) {
+                        posted++;
+                    }
+                    if (i % 2000 == 0) raise(SIGUSR1);
+                }
+            });
+        }
+        for (auto &w: workers) w.join();
+        bool flushed = EventBus::Flush(5000);
+        uint64_t expected = posted.load() + g_signalPosted.load();
+        uint64_t dropped = EventBus::Dropped();
+        if (!flushed) _exit(2);
+        if (g_sinkReceived.load() != expected) _exit(3);
+        if (!g_sinkOrdered.load()) _exit(4);
+        if (expected + dropped != (uint64_t) producers * perProducer + g_signalAttempts.load()) _exit(5);
+        _exit(0);
+    }, 30000);
+    EXPECT(!child.timedOut && WIFEXITED(child.status) && WEXITSTATUS(child.status) == 0,
+           "event bus delivery: status 0x%x", child.status);
+
+    for (int i = 0; i < rounds; ++i) {
+        std::string dir = bench::MakeTempDir("stress_event_");
+        int pipeFd[2];
+        if (pipe(pipeFd) != 0) break;
+        bench::ChildResult crash = bench::RunChild([&dir, &pipeFd](const std::function<void()> &) {
+            g_sinkFd = pipeFd[1];
+            EventBus::SetSink(PathSink);
+            CrashHandler::Init(dir);
+            bench::WaitDeferredInit();
+            raise(SIGSEGV);
+        });
+        close(pipeFd[1]);
+        char path[512] = {};
+        ssize_t n = read(pipeFd[0], path, sizeof(path) - 1);
+        close(pipeFd[0]);
+        std::string expectedPrefix = dir + "/crash-";
+        EXPECT(WIFSIGNALED(crash.status) && WTERMSIG(crash.status) == SIGSEGV, "round %d: status 0x%x", i, crash.status);
+        EXPECT(n > 0 && strncmp(path, expectedPrefix.c_str(), expectedPrefix.size()) == 0,
+               "round %d: crash event path '%s'", i, path);
+        EXPECT(n > 0 && ReadFile(path) == bench::ReadCrashReport(dir), "round %d: event path is not the report", i);
+        bench::RemoveTree(dir);
+    }
+}
+
+int main(int argc, char **argv) {
+    int rounds = argc > 1 ? std::max(1, atoi(argv[1])) : 25;
+    RepeatedSignals(rounds);
+    ConcurrentSignals(rounds, 8);
+    StorageQuota(rounds, 5);
+    GuardedAllocatorErrors();
+    ThreadStackOverflow(std::max(1, rounds / 5));
+    HprofLeakTraces();
+    CrashPackageRoundTrip();
+    EventBusDelivery(std::max(1, rounds / 5));
+    if (g_failures) {
+        fprintf(stderr, "%d failure(s)\n", g_failures);
+        return 1;
+    }
+    printf("signal_stress: all checks passed (%d rounds)\n", rounds);
+    return 0;
+}
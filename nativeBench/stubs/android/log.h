@@ -0,0 +1,38 @@
+// 主机构建用的android/log.h替身：只输出WARN及以上级别到stderr
+#ifndef NATIVE_BENCH_ANDROID_LOG_H
+#define NATIVE_BENCH_ANDROID_LOG_H
+
+#include <cstdarg>
+#include <cstdio>
+
+typedef enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+static inline int __android_log_vprint(int prio, const char *tag, const char *fmt, va_list ap) {
+    if (prio < ANDROID_LOG_WARN) {
+        return 0;
+    }
+    fprintf(stderr, "%s: ", tag);
+    int n = vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    return n;
+}
+
+static inline int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = __android_log_vprint(prio, tag, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+#endif //NATIVE_BENCH_ANDROID_LOG_H
@@ -0,0 +1,104 @@
+// 主机构建用的jni.h替身：只覆盖native模块用到的子集，全部为空实现
+// 主机上没有JVM，回调线程拿到的JNIEnv不会真正调用到Java层
+#ifndef NATIVE_BENCH_JNI_H
+#define NATIVE_BENCH_JNI_H
+
+#include <cstdint>
+
+typedef uint8_t jboolean;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef jint jsize;
+
+class _jobject {
+};
+
+typedef _jobject *jobject;
+typedef jobject jclass;
+typedef jobject jstring;
+typedef jobject jarray;
+typedef jarray jobjectArray;
+typedef jarray jlongArray;
+
+struct _jmethodID;
+typedef struct _jmethodID *jmethodID;
+
+#define JNI_OK           (0)
+#define JNI_ERR          (-1)
+#define JNI_VERSION_1_6  0x00010006
+
+#define JNIEXPORT __attribute__ ((visibility ("default")))
+#define JNICALL
+
+typedef struct {
+    const char *name;
+    const char *signature;
+    void *fnPtr;
+} JNINativeMethod;
+
+struct _JavaVM;
+typedef _JavaVM JavaVM;
+struct _JNIEnv;
+typedef _JNIEnv JNIEnv;
+
+JavaVM *jniStubVm();
+
+struct _JNIEnv {
+    jint GetJavaVM(JavaVM **vm) {
+        *vm = jniStubVm();
+        return JNI_OK;
+    }
+
+    jclass FindClass(const char *) { return nullptr; }
+
+    jobject NewGlobalRef(jobject obj) { return obj; }
+
+    void DeleteGlobalRef(jobject) {}
+
+    void DeleteLocalRef(jobject) {}
+
+    jclass GetObjectClass(jobject) { return nullptr; }
+
+    jmethodID GetMethodID(jclass, const char *, const char *) { return nullptr; }
+
+    void CallVoidMethod(jobject, jmethodID, ...) {}
+
+    jstring NewStringUTF(const char *) { return nullptr; }
+
+    const char *GetStringUTFChars(jstring, jboolean *) { return ""; }
+
+    void ReleaseStringUTFChars(jstring, const char *) {}
+
+    jsize GetArrayLength(jarray) { return 0; }
+
+    jobjectArray NewObjectArray(jsize, jclass, jobject) { return nullptr; }
+
+    void SetObjectArrayElement(jobjectArray, jsize, jobject) {}
+
+    void GetLongArrayRegion(jlongArray, jsize, jsize, jlong *) {}
+
+    jint RegisterNatives(jclass, const JNINativeMethod *, jint) { return JNI_OK; }
+
+    jint UnregisterNatives(jclass) { return JNI_OK; }
+};
+
+struct _JavaVM {
+    jint AttachCurrentThread(JNIEnv **env, void *) {
+        static JNIEnv stubEnv;
+        *env = &stubEnv;
+        return JNI_OK;
+    }
+
+    jint DetachCurrentThread() { return JNI_OK; }
+
+    jint GetEnv(void **env, jint version) {
+        return AttachCurrentThread(reinterpret_cast<JNIEnv **>(env), nullptr);
+    }
+};
+
+inline JavaVM *jniStubVm() {
+    static JavaVM vm;
+    return &vm;
+}
+
+#endif //NATIVE_BENCH_JNI_H